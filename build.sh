@@ -7,6 +7,7 @@ function usage() {
   -c DIR      Directory where EOSIO.CDT is installed. (Default: /usr/local/eosio.cdt)
   -d          Debug build type.
   -p          Preprod accounts.
+  -i          Instrumentation build (per-action resource counters).
   -t          Build unit tests.
   -y          Noninteractive mode (Uses defaults for each prompt.)
   -h          Print this help menu.
@@ -17,9 +18,10 @@ function usage() {
 CMAKE_BUILD_TYPE=Release
 BUILD_TESTS=false
 PREPROD=false
+INSTRUMENT=false
 
 if [ $# -ne 0 ]; then
-  while getopts "e:c:dptyh" opt; do
+  while getopts "e:c:dpityh" opt; do
     case "${opt}" in
       e )
         EOSIO_DIR_PROMPT=$OPTARG
@@ -33,6 +35,9 @@ if [ $# -ne 0 ]; then
       p )
         PREPROD=true
       ;;
+      i )
+        INSTRUMENT=true
+      ;;
       t )
         BUILD_TESTS=true
       ;;
@@ -89,6 +94,6 @@ NC='\033[0m'
 CPU_CORES=$(getconf _NPROCESSORS_ONLN)
 mkdir -p build
 pushd build &> /dev/null
-cmake -DCMAKE_BUILD_TYPE=${CMAKE_BUILD_TYPE} -DBUILD_TESTS=${BUILD_TESTS} -DPREPROD=${PREPROD} ../
+cmake -DCMAKE_BUILD_TYPE=${CMAKE_BUILD_TYPE} -DBUILD_TESTS=${BUILD_TESTS} -DPREPROD=${PREPROD} -DINSTRUMENT=${INSTRUMENT} ../
 make -j $CPU_CORES
 popd &> /dev/null
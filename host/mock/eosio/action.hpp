@@ -0,0 +1,87 @@
+#pragma once
+#include "host_chain.hpp"
+
+namespace eosio
+{
+    struct permission_level
+    {
+        permission_level(name a = name(), name p = name()) : actor(a), permission(p) {}
+
+        name actor;
+        name permission;
+
+        friend bool operator==(const permission_level &a, const permission_level &b)
+        {
+            return a.actor == b.actor && a.permission == b.permission;
+        }
+
+        EOSLIB_SERIALIZE(permission_level, (actor)(permission))
+    };
+
+    namespace internal_use_do_not_use
+    {
+        //Inline actions are queued for the harness, which runs the ones sent to the contract after the action
+        inline void send_inline(char *serialized_action, size_t size)
+        {
+            host_chain::inline_actions.emplace_back(serialized_action, serialized_action + size);
+        }
+    }
+
+    inline void require_auth(name n)
+    {
+        for (const auto &a : host_chain::auths)
+        {
+            if (a == n)
+                return;
+        }
+        check(false, "missing authority of " + n.to_string());
+    }
+
+    inline bool has_auth(name n)
+    {
+        for (const auto &a : host_chain::auths)
+        {
+            if (a == n)
+                return true;
+        }
+        return false;
+    }
+
+    inline void require_recipient(name notify_account)
+    {
+        host_chain::recipients.push_back(notify_account);
+    }
+
+    inline name get_sender()
+    {
+        return host_chain::sender;
+    }
+
+    struct action
+    {
+        eosio::name account;
+        eosio::name name;
+        std::vector<permission_level> authorization;
+        std::vector<char> data;
+
+        action() = default;
+
+        template <typename T>
+        action(const permission_level &auth, eosio::name a, eosio::name n, T &&value)
+            : account(a), name(n), authorization(1, auth), data(pack(std::forward<T>(value))) {}
+
+        template <typename T>
+        T data_as() const
+        {
+            return unpack<T>(data);
+        }
+
+        void send() const
+        {
+            auto serialized = pack(*this);
+            internal_use_do_not_use::send_inline(serialized.data(), serialized.size());
+        }
+
+        EOSLIB_SERIALIZE(action, (account)(name)(authorization)(data))
+    };
+}
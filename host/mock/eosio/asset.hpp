@@ -0,0 +1,178 @@
+#pragma once
+#include "symbol.hpp"
+
+namespace eosio
+{
+    struct asset
+    {
+        static constexpr int64_t max_amount = (1LL << 62) - 1;
+
+        int64_t amount = 0;
+        eosio::symbol symbol;
+
+        asset() {}
+        asset(int64_t a, class symbol s) : amount(a), symbol{s}
+        {
+            check(is_amount_within_range(), "magnitude of asset amount must be less than 2^62");
+            check(symbol.is_valid(), "invalid symbol name");
+        }
+
+        bool is_amount_within_range() const
+        {
+            return -max_amount <= amount && amount <= max_amount;
+        }
+
+        bool is_valid() const
+        {
+            return is_amount_within_range() && symbol.is_valid();
+        }
+
+        std::string to_string() const
+        {
+            return std::to_string(amount) + " " + symbol.code().to_string();
+        }
+
+        asset operator-() const
+        {
+            asset r = *this;
+            r.amount = -r.amount;
+            return r;
+        }
+
+        asset &operator-=(const asset &a)
+        {
+            check(a.symbol == symbol, "attempt to subtract asset with different symbol");
+            amount -= a.amount;
+            check(-max_amount <= amount, "subtraction underflow");
+            check(amount <= max_amount, "subtraction overflow");
+            return *this;
+        }
+
+        asset &operator+=(const asset &a)
+        {
+            check(a.symbol == symbol, "attempt to add asset with different symbol");
+            amount += a.amount;
+            check(-max_amount <= amount, "addition underflow");
+            check(amount <= max_amount, "addition overflow");
+            return *this;
+        }
+
+        friend asset operator+(const asset &a, const asset &b)
+        {
+            asset result = a;
+            result += b;
+            return result;
+        }
+
+        friend asset operator-(const asset &a, const asset &b)
+        {
+            asset result = a;
+            result -= b;
+            return result;
+        }
+
+        friend bool operator==(const asset &a, const asset &b)
+        {
+            check(a.symbol == b.symbol, "comparison of assets with different symbols is not allowed");
+            return a.amount == b.amount;
+        }
+        friend bool operator!=(const asset &a, const asset &b)
+        {
+            return !(a == b);
+        }
+        friend bool operator<(const asset &a, const asset &b)
+        {
+            check(a.symbol == b.symbol, "comparison of assets with different symbols is not allowed");
+            return a.amount < b.amount;
+        }
+        friend bool operator<=(const asset &a, const asset &b)
+        {
+            check(a.symbol == b.symbol, "comparison of assets with different symbols is not allowed");
+            return a.amount <= b.amount;
+        }
+        friend bool operator>(const asset &a, const asset &b)
+        {
+            check(a.symbol == b.symbol, "comparison of assets with different symbols is not allowed");
+            return a.amount > b.amount;
+        }
+        friend bool operator>=(const asset &a, const asset &b)
+        {
+            check(a.symbol == b.symbol, "comparison of assets with different symbols is not allowed");
+            return a.amount >= b.amount;
+        }
+
+        EOSLIB_SERIALIZE(asset, (amount)(symbol))
+    };
+
+    struct extended_asset
+    {
+        asset quantity;
+        name contract;
+
+        extended_symbol get_extended_symbol() const
+        {
+            return extended_symbol{quantity.symbol, contract};
+        }
+
+        extended_asset() = default;
+        extended_asset(int64_t v, extended_symbol s) : quantity(v, s.get_symbol()), contract(s.get_contract()) {}
+        extended_asset(asset a, name c) : quantity(a), contract(c) {}
+
+        extended_asset operator-() const
+        {
+            return {-quantity, contract};
+        }
+
+        friend extended_asset operator-(const extended_asset &a, const extended_asset &b)
+        {
+            check(a.contract == b.contract, "type mismatch");
+            return {a.quantity - b.quantity, a.contract};
+        }
+
+        friend extended_asset operator+(const extended_asset &a, const extended_asset &b)
+        {
+            check(a.contract == b.contract, "type mismatch");
+            return {a.quantity + b.quantity, a.contract};
+        }
+
+        extended_asset &operator+=(const extended_asset &other)
+        {
+            check(contract == other.contract, "type mismatch");
+            quantity += other.quantity;
+            return *this;
+        }
+
+        extended_asset &operator-=(const extended_asset &other)
+        {
+            check(contract == other.contract, "type mismatch");
+            quantity -= other.quantity;
+            return *this;
+        }
+
+        friend bool operator<(const extended_asset &a, const extended_asset &b)
+        {
+            check(a.contract == b.contract, "type mismatch");
+            return a.quantity < b.quantity;
+        }
+        friend bool operator==(const extended_asset &a, const extended_asset &b)
+        {
+            return std::tie(a.quantity, a.contract) == std::tie(b.quantity, b.contract);
+        }
+        friend bool operator!=(const extended_asset &a, const extended_asset &b)
+        {
+            return std::tie(a.quantity, a.contract) != std::tie(b.quantity, b.contract);
+        }
+        friend bool operator<=(const extended_asset &a, const extended_asset &b)
+        {
+            check(a.contract == b.contract, "type mismatch");
+            return a.quantity <= b.quantity;
+        }
+        friend bool operator>=(const extended_asset &a, const extended_asset &b)
+        {
+            check(a.contract == b.contract, "type mismatch");
+            return a.quantity >= b.quantity;
+        }
+
+        EOSLIB_SERIALIZE(extended_asset, (quantity)(contract))
+    };
+}
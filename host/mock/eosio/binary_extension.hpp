@@ -0,0 +1,70 @@
+#pragma once
+#include "datastream.hpp"
+
+namespace eosio
+{
+    //Field appended to a row layout, present only in rows written after it was added
+    template <typename T>
+    class binary_extension
+    {
+    public:
+        constexpr binary_extension() {}
+        constexpr binary_extension(const T &ext) : _value(ext) {}
+
+        constexpr bool has_value() const
+        {
+            return _value.has_value();
+        }
+        constexpr T &value()
+        {
+            check(has_value(), "cannot get value of empty binary_extension");
+            return *_value;
+        }
+        constexpr const T &value() const
+        {
+            check(has_value(), "cannot get value of empty binary_extension");
+            return *_value;
+        }
+        constexpr T value_or() const
+        {
+            return has_value() ? *_value : T{};
+        }
+        constexpr T value_or(const T &def) const
+        {
+            return has_value() ? *_value : def;
+        }
+        template <typename... Args>
+        binary_extension &emplace(Args &&... args)
+        {
+            _value.emplace(std::forward<Args>(args)...);
+            return *this;
+        }
+        void reset()
+        {
+            _value.reset();
+        }
+
+    private:
+        std::optional<T> _value;
+    };
+
+    template <typename DataStream, typename T>
+    DataStream &operator<<(DataStream &ds, const binary_extension<T> &be)
+    {
+        if (be.has_value())
+            ds << be.value();
+        return ds;
+    }
+
+    template <typename DataStream, typename T>
+    DataStream &operator>>(DataStream &ds, binary_extension<T> &be)
+    {
+        if (ds.remaining())
+        {
+            T value;
+            ds >> value;
+            be.emplace(value);
+        }
+        return ds;
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+namespace eosio
+{
+    //A failed check aborts the action, on the host it throws so the harness can revert and report it
+    struct assert_error : std::runtime_error
+    {
+        using std::runtime_error::runtime_error;
+    };
+
+    inline void check(bool pred, const char *msg)
+    {
+        if (!pred)
+            throw assert_error(msg);
+    }
+
+    inline void check(bool pred, const std::string &msg)
+    {
+        if (!pred)
+            throw assert_error(msg);
+    }
+
+    inline void check(bool pred, std::string &&msg)
+    {
+        if (!pred)
+            throw assert_error(msg);
+    }
+
+    inline void check(bool pred, const char *msg, size_t n)
+    {
+        if (!pred)
+            throw assert_error(std::string(msg, n));
+    }
+
+    inline void check(bool pred, uint64_t code)
+    {
+        if (!pred)
+            throw assert_error("error code " + std::to_string(code));
+    }
+}
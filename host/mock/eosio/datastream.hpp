@@ -0,0 +1,500 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <boost/preprocessor/seq/for_each.hpp>
+#include "check.hpp"
+
+typedef unsigned __int128 uint128_t;
+typedef __int128 int128_t;
+
+namespace eosio
+{
+    //Same byte layout as the eosio.cdt datastream: little endian integers, varuint32 sizes
+    template <typename T>
+    class datastream
+    {
+    public:
+        datastream(T start, size_t size) : _start(start), _pos(start), _end(start + size) {}
+
+        void skip(size_t size)
+        {
+            _pos += size;
+        }
+
+        bool read(char *dest, size_t size)
+        {
+            check(size_t(_end - _pos) >= size, "datastream attempted to read past the end");
+            std::memcpy(dest, _pos, size);
+            _pos += size;
+            return true;
+        }
+
+        bool write(const char *src, size_t size)
+        {
+            check(size_t(_end - _pos) >= size, "datastream attempted to write past the end");
+            std::memcpy((void *)_pos, src, size);
+            _pos += size;
+            return true;
+        }
+
+        bool write(char c)
+        {
+            return write(&c, 1);
+        }
+
+        T pos() const
+        {
+            return _pos;
+        }
+
+        size_t tellp() const
+        {
+            return size_t(_pos - _start);
+        }
+
+        size_t remaining() const
+        {
+            return size_t(_end - _pos);
+        }
+
+    private:
+        T _start;
+        T _pos;
+        T _end;
+    };
+
+    //Counts bytes only, pack_size runs the same operators over it
+    template <>
+    class datastream<size_t>
+    {
+    public:
+        datastream(size_t init = 0) : _size(init) {}
+
+        void skip(size_t size)
+        {
+            _size += size;
+        }
+
+        bool write(const char *, size_t size)
+        {
+            _size += size;
+            return true;
+        }
+
+        bool write(char)
+        {
+            ++_size;
+            return true;
+        }
+
+        size_t tellp() const
+        {
+            return _size;
+        }
+
+        size_t remaining() const
+        {
+            return 0;
+        }
+
+    private:
+        size_t _size;
+    };
+
+    struct unsigned_int
+    {
+        unsigned_int(uint32_t v = 0) : value(v) {}
+
+        template <typename T>
+        unsigned_int(T v) : value(uint32_t(v)) {}
+
+        operator uint32_t() const
+        {
+            return value;
+        }
+
+        uint32_t value;
+    };
+
+    template <typename DataStream, typename T, std::enable_if_t<std::is_arithmetic_v<T> || std::is_enum_v<T>> * = nullptr>
+    DataStream &operator<<(DataStream &ds, const T &v)
+    {
+        ds.write((const char *)&v, sizeof(T));
+        return ds;
+    }
+
+    template <typename DataStream, typename T, std::enable_if_t<std::is_arithmetic_v<T> || std::is_enum_v<T>> * = nullptr>
+    DataStream &operator>>(DataStream &ds, T &v)
+    {
+        ds.read((char *)&v, sizeof(T));
+        return ds;
+    }
+
+    template <typename DataStream>
+    DataStream &operator<<(DataStream &ds, const bool &v)
+    {
+        uint8_t byte = v ? 1 : 0;
+        ds.write((const char *)&byte, 1);
+        return ds;
+    }
+
+    template <typename DataStream>
+    DataStream &operator>>(DataStream &ds, bool &v)
+    {
+        uint8_t byte;
+        ds.read((char *)&byte, 1);
+        v = byte != 0;
+        return ds;
+    }
+
+    template <typename DataStream>
+    DataStream &operator<<(DataStream &ds, const uint128_t &v)
+    {
+        ds.write((const char *)&v, sizeof(v));
+        return ds;
+    }
+
+    template <typename DataStream>
+    DataStream &operator>>(DataStream &ds, uint128_t &v)
+    {
+        ds.read((char *)&v, sizeof(v));
+        return ds;
+    }
+
+    template <typename DataStream>
+    DataStream &operator<<(DataStream &ds, const int128_t &v)
+    {
+        ds.write((const char *)&v, sizeof(v));
+        return ds;
+    }
+
+    template <typename DataStream>
+    DataStream &operator>>(DataStream &ds, int128_t &v)
+    {
+        ds.read((char *)&v, sizeof(v));
+        return ds;
+    }
+
+    template <typename DataStream>
+    DataStream &operator<<(DataStream &ds, const unsigned_int &v)
+    {
+        uint64_t value = v.value;
+        do
+        {
+            uint8_t byte = uint8_t(value & 0x7f);
+            value >>= 7;
+            byte |= uint8_t((value > 0) << 7);
+            ds.write((const char *)&byte, 1);
+        } while (value);
+        return ds;
+    }
+
+    template <typename DataStream>
+    DataStream &operator>>(DataStream &ds, unsigned_int &v)
+    {
+        uint64_t value = 0;
+        uint8_t byte;
+        uint8_t shift = 0;
+        do
+        {
+            ds.read((char *)&byte, 1);
+            value |= uint64_t(byte & 0x7f) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        v.value = uint32_t(value);
+        return ds;
+    }
+
+    template <typename DataStream, typename Char, typename Traits, typename Alloc>
+    DataStream &operator<<(DataStream &ds, const std::basic_string<Char, Traits, Alloc> &v)
+    {
+        ds << unsigned_int(v.size());
+        if (v.size())
+            ds.write(v.data(), v.size());
+        return ds;
+    }
+
+    template <typename DataStream, typename Char, typename Traits, typename Alloc>
+    DataStream &operator>>(DataStream &ds, std::basic_string<Char, Traits, Alloc> &v)
+    {
+        unsigned_int size;
+        ds >> size;
+        v.resize(size.value);
+        if (size.value)
+            ds.read(v.data(), size.value);
+        return ds;
+    }
+
+    template <typename DataStream>
+    DataStream &operator<<(DataStream &ds, const std::string_view &v)
+    {
+        ds << unsigned_int(v.size());
+        if (v.size())
+            ds.write(v.data(), v.size());
+        return ds;
+    }
+
+    template <typename DataStream, typename T, typename Alloc>
+    DataStream &operator<<(DataStream &ds, const std::vector<T, Alloc> &v)
+    {
+        ds << unsigned_int(v.size());
+        for (const auto &i : v)
+            ds << i;
+        return ds;
+    }
+
+    template <typename DataStream, typename T, typename Alloc>
+    DataStream &operator>>(DataStream &ds, std::vector<T, Alloc> &v)
+    {
+        unsigned_int size;
+        ds >> size;
+        v.resize(size.value);
+        for (auto &i : v)
+            ds >> i;
+        return ds;
+    }
+
+    template <typename DataStream, typename T, size_t N>
+    DataStream &operator<<(DataStream &ds, const std::array<T, N> &v)
+    {
+        for (const auto &i : v)
+            ds << i;
+        return ds;
+    }
+
+    template <typename DataStream, typename T, size_t N>
+    DataStream &operator>>(DataStream &ds, std::array<T, N> &v)
+    {
+        for (auto &i : v)
+            ds >> i;
+        return ds;
+    }
+
+    template <typename DataStream, typename A, typename B>
+    DataStream &operator<<(DataStream &ds, const std::pair<A, B> &v)
+    {
+        ds << v.first;
+        ds << v.second;
+        return ds;
+    }
+
+    template <typename DataStream, typename A, typename B>
+    DataStream &operator>>(DataStream &ds, std::pair<A, B> &v)
+    {
+        ds >> v.first;
+        ds >> v.second;
+        return ds;
+    }
+
+    template <typename DataStream, typename K, typename V, typename C, typename A>
+    DataStream &operator<<(DataStream &ds, const std::map<K, V, C, A> &v)
+    {
+        ds << unsigned_int(v.size());
+        for (const auto &i : v)
+            ds << i.first << i.second;
+        return ds;
+    }
+
+    template <typename DataStream, typename T>
+    DataStream &operator<<(DataStream &ds, const std::optional<T> &v)
+    {
+        ds << v.has_value();
+        if (v)
+            ds << *v;
+        return ds;
+    }
+
+    template <typename DataStream, typename T>
+    DataStream &operator>>(DataStream &ds, std::optional<T> &v)
+    {
+        bool has;
+        ds >> has;
+        if (has)
+        {
+            T value;
+            ds >> value;
+            v = std::move(value);
+        }
+        else
+        {
+            v.reset();
+        }
+        return ds;
+    }
+
+    template <typename DataStream, typename... Args>
+    DataStream &operator<<(DataStream &ds, const std::tuple<Args...> &v)
+    {
+        std::apply([&](const auto &... field) { ((ds << field), ...); }, v);
+        return ds;
+    }
+
+    template <typename DataStream, typename... Args>
+    DataStream &operator>>(DataStream &ds, std::tuple<Args...> &v)
+    {
+        std::apply([&](auto &... field) { ((ds >> field), ...); }, v);
+        return ds;
+    }
+
+    //Table rows without EOSLIB_SERIALIZE are packed field by field, as eosio.cdt does with boost::pfr
+    namespace reflect
+    {
+        struct any_field
+        {
+            template <typename U>
+            operator U() const;
+        };
+
+        template <typename T, size_t... I>
+        auto is_constructible(std::index_sequence<I...>, int) -> decltype(T{(void(I), any_field{})...}, std::true_type{});
+
+        template <typename T, size_t... I>
+        std::false_type is_constructible(std::index_sequence<I...>, long);
+
+        template <typename T, size_t N = 1>
+        constexpr size_t field_count()
+        {
+            if constexpr (N <= 16 && decltype(is_constructible<T>(std::make_index_sequence<N>{}, 0))::value)
+                return field_count<T, N + 1>();
+            else
+                return N - 1;
+        }
+
+        template <typename T, typename F>
+        void for_each_field(T &&v, F &&f)
+        {
+            constexpr auto count = field_count<std::decay_t<T>>();
+            static_assert(count > 0 && count <= 12, "reflect : unsupported row layout");
+            if constexpr (count == 1)
+            {
+                auto &[a] = v;
+                f(a);
+            }
+            else if constexpr (count == 2)
+            {
+                auto &[a, b] = v;
+                f(a), f(b);
+            }
+            else if constexpr (count == 3)
+            {
+                auto &[a, b, c] = v;
+                f(a), f(b), f(c);
+            }
+            else if constexpr (count == 4)
+            {
+                auto &[a, b, c, d] = v;
+                f(a), f(b), f(c), f(d);
+            }
+            else if constexpr (count == 5)
+            {
+                auto &[a, b, c, d, e] = v;
+                f(a), f(b), f(c), f(d), f(e);
+            }
+            else if constexpr (count == 6)
+            {
+                auto &[a, b, c, d, e, g] = v;
+                f(a), f(b), f(c), f(d), f(e), f(g);
+            }
+            else if constexpr (count == 7)
+            {
+                auto &[a, b, c, d, e, g, h] = v;
+                f(a), f(b), f(c), f(d), f(e), f(g), f(h);
+            }
+            else if constexpr (count == 8)
+            {
+                auto &[a, b, c, d, e, g, h, i] = v;
+                f(a), f(b), f(c), f(d), f(e), f(g), f(h), f(i);
+            }
+            else if constexpr (count == 9)
+            {
+                auto &[a, b, c, d, e, g, h, i, j] = v;
+                f(a), f(b), f(c), f(d), f(e), f(g), f(h), f(i), f(j);
+            }
+            else if constexpr (count == 10)
+            {
+                auto &[a, b, c, d, e, g, h, i, j, k] = v;
+                f(a), f(b), f(c), f(d), f(e), f(g), f(h), f(i), f(j), f(k);
+            }
+            else if constexpr (count == 11)
+            {
+                auto &[a, b, c, d, e, g, h, i, j, k, l] = v;
+                f(a), f(b), f(c), f(d), f(e), f(g), f(h), f(i), f(j), f(k), f(l);
+            }
+            else
+            {
+                auto &[a, b, c, d, e, g, h, i, j, k, l, m] = v;
+                f(a), f(b), f(c), f(d), f(e), f(g), f(h), f(i), f(j), f(k), f(l), f(m);
+            }
+        }
+    }
+
+    template <typename DataStream, typename T, std::enable_if_t<std::is_class_v<T> && std::is_aggregate_v<T>> * = nullptr>
+    DataStream &operator<<(DataStream &ds, const T &v)
+    {
+        reflect::for_each_field(v, [&](const auto &field) { ds << field; });
+        return ds;
+    }
+
+    template <typename DataStream, typename T, std::enable_if_t<std::is_class_v<T> && std::is_aggregate_v<T>> * = nullptr>
+    DataStream &operator>>(DataStream &ds, T &v)
+    {
+        reflect::for_each_field(v, [&](auto &field) { ds >> field; });
+        return ds;
+    }
+
+    template <typename T>
+    size_t pack_size(const T &value)
+    {
+        datastream<size_t> ps;
+        ps << value;
+        return ps.tellp();
+    }
+
+    template <typename T>
+    std::vector<char> pack(const T &value)
+    {
+        std::vector<char> result(pack_size(value));
+        datastream<char *> ds(result.data(), result.size());
+        ds << value;
+        return result;
+    }
+
+    template <typename T>
+    T unpack(const char *buffer, size_t len)
+    {
+        T result;
+        datastream<const char *> ds(buffer, len);
+        ds >> result;
+        return result;
+    }
+
+    template <typename T>
+    T unpack(const std::vector<char> &bytes)
+    {
+        return unpack<T>(bytes.data(), bytes.size());
+    }
+}
+
+#define EOSLIB_REFLECT_MEMBER_OP(r, OP, elem) \
+    OP t.elem
+
+#define EOSLIB_SERIALIZE(TYPE, MEMBERS)                                          \
+    template <typename DataStream>                                               \
+    friend DataStream &operator<<(DataStream &ds, const TYPE &t)                 \
+    {                                                                            \
+        return ds BOOST_PP_SEQ_FOR_EACH(EOSLIB_REFLECT_MEMBER_OP, <<, MEMBERS);  \
+    }                                                                            \
+    template <typename DataStream>                                               \
+    friend DataStream &operator>>(DataStream &ds, TYPE &t)                       \
+    {                                                                            \
+        return ds BOOST_PP_SEQ_FOR_EACH(EOSLIB_REFLECT_MEMBER_OP, >>, MEMBERS);  \
+    }
@@ -0,0 +1,14 @@
+#pragma once
+//Stand-ins for the eosio.cdt headers, so the contract sources compile natively for the host tools
+#include "action.hpp"
+#include "asset.hpp"
+#include "binary_extension.hpp"
+#include "check.hpp"
+#include "contract.hpp"
+#include "crypto.hpp"
+#include "datastream.hpp"
+#include "multi_index.hpp"
+#include "name.hpp"
+#include "symbol.hpp"
+#include "system.hpp"
+#include "time.hpp"
@@ -0,0 +1,99 @@
+#pragma once
+#include <array>
+#include <cstdlib>
+#include <map>
+#include <tuple>
+#include <vector>
+#include "name.hpp"
+
+//State the stand-in intrinsics read and write. Its containers allocate with malloc, so the heap counters of
+//the instrumentation build only see allocations made by the contract code itself, as they do on chain.
+namespace host_chain
+{
+    template <typename T>
+    struct raw_allocator
+    {
+        using value_type = T;
+
+        raw_allocator() = default;
+        template <typename U>
+        raw_allocator(const raw_allocator<U> &) {}
+
+        T *allocate(size_t n)
+        {
+            return (T *)std::malloc(n * sizeof(T));
+        }
+        void deallocate(T *ptr, size_t)
+        {
+            std::free(ptr);
+        }
+
+        template <typename U>
+        bool operator==(const raw_allocator<U> &) const
+        {
+            return true;
+        }
+        template <typename U>
+        bool operator!=(const raw_allocator<U> &) const
+        {
+            return false;
+        }
+    };
+
+    using bytes = std::vector<char, raw_allocator<char>>;
+
+    template <typename K, typename V>
+    using raw_map = std::map<K, V, std::less<K>, raw_allocator<std::pair<const K, V>>>;
+
+    struct table_id
+    {
+        uint64_t code;
+        uint64_t scope;
+        uint64_t table;
+
+        bool operator<(const table_id &other) const
+        {
+            return std::tie(code, scope, table) < std::tie(other.code, other.scope, other.table);
+        }
+    };
+
+    struct row
+    {
+        uint64_t payer;
+        bytes data;
+    };
+
+    using table = raw_map<uint64_t, row>;
+
+    //Secondary keys of every kind are widened to 256 bits, the second half of the pair is the primary key
+    using secondary_key = std::array<uint64_t, 4>;
+    using index = raw_map<std::pair<secondary_key, uint64_t>, char>;
+
+    inline raw_map<table_id, table> db;
+    inline raw_map<std::pair<table_id, uint64_t>, index> index_db;
+
+    //Context of the action being run
+    inline eosio::name self;
+    inline std::vector<eosio::name, raw_allocator<eosio::name>> auths;
+    inline eosio::name sender;
+    inline uint64_t now_us = 1600000000000000ull;
+    inline bytes transaction;
+    inline std::vector<bytes, raw_allocator<bytes>> inline_actions;
+    inline std::vector<eosio::name, raw_allocator<eosio::name>> recipients;
+
+    inline table &get_table(eosio::name code, uint64_t scope, uint64_t table_name)
+    {
+        return db[table_id{code.value, scope, table_name}];
+    }
+
+    inline const table *find_table(eosio::name code, uint64_t scope, uint64_t table_name)
+    {
+        auto it = db.find(table_id{code.value, scope, table_name});
+        return it == db.end() ? nullptr : &it->second;
+    }
+
+    inline index &get_index(eosio::name code, uint64_t scope, uint64_t table_name, uint64_t index_name)
+    {
+        return index_db[{table_id{code.value, scope, table_name}, index_name}];
+    }
+}
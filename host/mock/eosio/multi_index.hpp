@@ -0,0 +1,537 @@
+#pragma once
+#include <limits>
+#include <memory>
+#include "crypto.hpp"
+#include "host_chain.hpp"
+
+namespace eosio
+{
+    static constexpr name same_payer{};
+
+    template <name::raw IndexName, typename Extractor>
+    struct indexed_by
+    {
+        static constexpr uint64_t index_name = uint64_t(IndexName);
+        typedef Extractor secondary_extractor_type;
+    };
+
+    template <class Class, typename Type, Type (Class::*PtrToMemberFunction)() const>
+    struct const_mem_fun
+    {
+        typedef std::remove_cv_t<std::remove_reference_t<Type>> result_type;
+
+        template <typename ChainedPtr>
+        result_type operator()(const ChainedPtr &x) const
+        {
+            return (x.*PtrToMemberFunction)();
+        }
+    };
+
+    inline host_chain::secondary_key to_secondary_key(uint64_t key)
+    {
+        return {0, 0, 0, key};
+    }
+
+    inline host_chain::secondary_key to_secondary_key(uint128_t key)
+    {
+        return {0, 0, uint64_t(key >> 64), uint64_t(key)};
+    }
+
+    inline host_chain::secondary_key to_secondary_key(const checksum256 &key)
+    {
+        host_chain::secondary_key result{};
+        for (size_t i = 0; i < 32; ++i)
+        {
+            result[i / 8] = (result[i / 8] << 8) | key.bytes[i];
+        }
+        return result;
+    }
+
+    //Keeps a cache of the rows it has read, like the eosio.cdt multi_index, so a handle that is kept
+    //serves repeated lookups without deserializing again while a fresh handle loads the row anew.
+    template <name::raw TableName, typename T, typename... Indices>
+    class multi_index
+    {
+    private:
+        struct item
+        {
+            T value;
+            uint64_t primary_key;
+        };
+
+        template <size_t N>
+        using index_at = std::tuple_element_t<N, std::tuple<Indices...>>;
+
+    public:
+        class const_iterator
+        {
+        public:
+            const_iterator() = default;
+            const_iterator(const multi_index *mi, const item *i) : _mi(mi), _item(i) {}
+
+            const T &operator*() const
+            {
+                check(_item != nullptr, "cannot dereference end iterator");
+                return _item->value;
+            }
+            const T *operator->() const
+            {
+                check(_item != nullptr, "cannot dereference end iterator");
+                return &_item->value;
+            }
+
+            const_iterator &operator++()
+            {
+                check(_item != nullptr, "cannot increment end iterator");
+                _item = _mi->next_item(_item->primary_key);
+                return *this;
+            }
+            const_iterator operator++(int)
+            {
+                auto prev = *this;
+                ++*this;
+                return prev;
+            }
+
+            const_iterator &operator--()
+            {
+                _item = _mi->previous_item(_item);
+                return *this;
+            }
+            const_iterator operator--(int)
+            {
+                auto prev = *this;
+                --*this;
+                return prev;
+            }
+
+            friend bool operator==(const const_iterator &a, const const_iterator &b)
+            {
+                return a._item == b._item;
+            }
+            friend bool operator!=(const const_iterator &a, const const_iterator &b)
+            {
+                return a._item != b._item;
+            }
+
+        private:
+            friend class multi_index;
+            const multi_index *_mi = nullptr;
+            const item *_item = nullptr;
+        };
+
+        template <size_t N>
+        class index
+        {
+        public:
+            using extractor = typename index_at<N>::secondary_extractor_type;
+            using key_type = typename extractor::result_type;
+
+            class const_iterator
+            {
+            public:
+                const_iterator() = default;
+                const_iterator(const index *idx, const item *i) : _idx(idx), _item(i) {}
+
+                const T &operator*() const
+                {
+                    check(_item != nullptr, "cannot dereference end iterator");
+                    return _item->value;
+                }
+                const T *operator->() const
+                {
+                    check(_item != nullptr, "cannot dereference end iterator");
+                    return &_item->value;
+                }
+
+                const_iterator &operator++()
+                {
+                    check(_item != nullptr, "cannot increment end iterator");
+                    auto &rows = _idx->rows();
+                    auto it = rows.upper_bound({index::key_of(_item->value), _item->primary_key});
+                    _item = it == rows.end() ? nullptr : _idx->_mi->load(it->first.second);
+                    return *this;
+                }
+                const_iterator operator++(int)
+                {
+                    auto prev = *this;
+                    ++*this;
+                    return prev;
+                }
+
+                const_iterator &operator--()
+                {
+                    auto &rows = _idx->rows();
+                    auto it = _item == nullptr ? rows.end() : rows.find({index::key_of(_item->value), _item->primary_key});
+                    check(it != rows.begin(), "cannot decrement iterator at beginning of index");
+                    --it;
+                    _item = _idx->_mi->load(it->first.second);
+                    return *this;
+                }
+                const_iterator operator--(int)
+                {
+                    auto prev = *this;
+                    --*this;
+                    return prev;
+                }
+
+                friend bool operator==(const const_iterator &a, const const_iterator &b)
+                {
+                    return a._item == b._item;
+                }
+                friend bool operator!=(const const_iterator &a, const const_iterator &b)
+                {
+                    return a._item != b._item;
+                }
+
+            private:
+                friend class index;
+                const index *_idx = nullptr;
+                const item *_item = nullptr;
+            };
+
+            explicit index(multi_index *mi) : _mi(mi) {}
+
+            const_iterator begin() const
+            {
+                auto &r = rows();
+                return at(r.begin());
+            }
+            const_iterator end() const
+            {
+                return const_iterator(this, nullptr);
+            }
+
+            const_iterator lower_bound(const key_type &key) const
+            {
+                return at(rows().lower_bound({to_secondary_key(key), 0}));
+            }
+            const_iterator upper_bound(const key_type &key) const
+            {
+                return at(rows().upper_bound({to_secondary_key(key), std::numeric_limits<uint64_t>::max()}));
+            }
+
+            const_iterator find(const key_type &key) const
+            {
+                auto it = lower_bound(key);
+                if (it != end() && key_of(*it) != to_secondary_key(key))
+                {
+                    return end();
+                }
+                return it;
+            }
+
+            const T &get(const key_type &key, const char *error_msg = "unable to find secondary key") const
+            {
+                auto it = find(key);
+                check(it != end(), error_msg);
+                return *it;
+            }
+
+            const_iterator iterator_to(const T &obj) const
+            {
+                return const_iterator(this, _mi->item_of(obj));
+            }
+
+            template <typename Lambda>
+            void modify(const const_iterator &it, name payer, Lambda &&updater)
+            {
+                check(it != end(), "cannot pass end iterator to modify");
+                _mi->modify(*it, payer, std::forward<Lambda>(updater));
+            }
+
+            const_iterator erase(const_iterator it)
+            {
+                check(it != end(), "cannot pass end iterator to erase");
+                const auto &obj = *it;
+                ++it;
+                _mi->erase(obj);
+                return it;
+            }
+
+            static host_chain::secondary_key key_of(const T &obj)
+            {
+                return to_secondary_key(extractor()(obj));
+            }
+
+        private:
+            const_iterator at(host_chain::index::const_iterator it) const
+            {
+                return const_iterator(this, it == rows().end() ? nullptr : _mi->load(it->first.second));
+            }
+
+            host_chain::index &rows() const
+            {
+                return _mi->index_rows(index_at<N>::index_name);
+            }
+
+            multi_index *_mi;
+        };
+
+        multi_index(name code, uint64_t scope) : _code(code), _scope(scope) {}
+
+        multi_index(const multi_index &) = delete;
+        multi_index &operator=(const multi_index &) = delete;
+
+        ~multi_index()
+        {
+            for (auto i : _items)
+            {
+                delete i;
+            }
+        }
+
+        name get_code() const
+        {
+            return _code;
+        }
+        uint64_t get_scope() const
+        {
+            return _scope;
+        }
+
+        const_iterator begin() const
+        {
+            auto table = rows();
+            return const_iterator(this, table == nullptr || table->empty() ? nullptr : load(table->begin()->first));
+        }
+        const_iterator end() const
+        {
+            return const_iterator(this, nullptr);
+        }
+
+        const_iterator lower_bound(uint64_t primary) const
+        {
+            auto table = rows();
+            if (table == nullptr)
+            {
+                return end();
+            }
+            auto it = table->lower_bound(primary);
+            return const_iterator(this, it == table->end() ? nullptr : load(it->first));
+        }
+        const_iterator upper_bound(uint64_t primary) const
+        {
+            auto table = rows();
+            if (table == nullptr)
+            {
+                return end();
+            }
+            auto it = table->upper_bound(primary);
+            return const_iterator(this, it == table->end() ? nullptr : load(it->first));
+        }
+
+        const_iterator find(uint64_t primary) const
+        {
+            auto table = rows();
+            if (table == nullptr || table->count(primary) == 0)
+            {
+                return end();
+            }
+            return const_iterator(this, load(primary));
+        }
+
+        const_iterator require_find(uint64_t primary, const char *error_msg = "unable to find key") const
+        {
+            auto it = find(primary);
+            check(it != end(), error_msg);
+            return it;
+        }
+
+        const T &get(uint64_t primary, const char *error_msg = "unable to find key") const
+        {
+            auto it = find(primary);
+            check(it != end(), error_msg);
+            return *it;
+        }
+
+        const_iterator iterator_to(const T &obj) const
+        {
+            return const_iterator(this, item_of(obj));
+        }
+
+        uint64_t available_primary_key() const
+        {
+            if (_next_primary_key == unset_next_primary_key)
+            {
+                auto table = rows();
+                _next_primary_key = table == nullptr || table->empty() ? 0 : table->rbegin()->first + 1;
+            }
+            check(_next_primary_key < no_available_primary_key, "next primary key in table is at autoincrement limit");
+            return _next_primary_key;
+        }
+
+        template <name::raw IndexName>
+        auto get_index() const
+        {
+            return index<index_number<IndexName>()>(const_cast<multi_index *>(this));
+        }
+
+        template <typename Lambda>
+        const_iterator emplace(name payer, Lambda &&constructor)
+        {
+            check(_code == host_chain::self, "cannot create objects in table of another contract");
+            auto i = new item();
+            constructor(i->value);
+            i->primary_key = i->value.primary_key();
+
+            auto &table = host_chain::get_table(_code, _scope, uint64_t(TableName));
+            check(table.count(i->primary_key) == 0, "could not insert object, most likely a uniqueness constraint was violated");
+            table[i->primary_key] = host_chain::row{payer.value, serialize(i->value)};
+            add_secondary_keys(i->value, std::make_index_sequence<sizeof...(Indices)>{});
+
+            if (i->primary_key >= _next_primary_key || _next_primary_key == unset_next_primary_key)
+            {
+                _next_primary_key = i->primary_key >= no_available_primary_key ? no_available_primary_key : i->primary_key + 1;
+            }
+            _items.push_back(i);
+            return const_iterator(this, i);
+        }
+
+        template <typename Lambda>
+        void modify(const const_iterator &it, name payer, Lambda &&updater)
+        {
+            check(it != end(), "cannot pass end iterator to modify");
+            modify(*it, payer, std::forward<Lambda>(updater));
+        }
+
+        template <typename Lambda>
+        void modify(const T &obj, name payer, Lambda &&updater)
+        {
+            check(_code == host_chain::self, "cannot modify objects in table of another contract");
+            auto i = const_cast<item *>(item_of(obj));
+            remove_secondary_keys(i->value, std::make_index_sequence<sizeof...(Indices)>{});
+            updater(i->value);
+            check(i->value.primary_key() == i->primary_key, "updater cannot change primary key when modifying an object");
+
+            auto &row = host_chain::get_table(_code, _scope, uint64_t(TableName))[i->primary_key];
+            row.data = serialize(i->value);
+            if (payer != same_payer)
+            {
+                row.payer = payer.value;
+            }
+            add_secondary_keys(i->value, std::make_index_sequence<sizeof...(Indices)>{});
+        }
+
+        const_iterator erase(const_iterator it)
+        {
+            check(it != end(), "cannot pass end iterator to erase");
+            const auto &obj = *it;
+            ++it;
+            erase(obj);
+            return it;
+        }
+
+        void erase(const T &obj)
+        {
+            check(_code == host_chain::self, "cannot erase objects in table of another contract");
+            auto i = item_of(obj);
+            remove_secondary_keys(i->value, std::make_index_sequence<sizeof...(Indices)>{});
+            host_chain::get_table(_code, _scope, uint64_t(TableName)).erase(i->primary_key);
+            _items.erase(std::find(_items.begin(), _items.end(), i));
+            delete i;
+        }
+
+    private:
+        static constexpr uint64_t unset_next_primary_key = std::numeric_limits<uint64_t>::max();
+        static constexpr uint64_t no_available_primary_key = std::numeric_limits<uint64_t>::max() - 1;
+
+        template <name::raw IndexName, size_t N = 0>
+        static constexpr size_t index_number()
+        {
+            static_assert(N < sizeof...(Indices), "name provided is not the name of any secondary index within multi_index");
+            if constexpr (index_at<N>::index_name == uint64_t(IndexName))
+            {
+                return N;
+            }
+            else
+            {
+                return index_number<IndexName, N + 1>();
+            }
+        }
+
+        static host_chain::bytes serialize(const T &obj)
+        {
+            host_chain::bytes data(pack_size(obj));
+            datastream<char *> ds(data.data(), data.size());
+            ds << obj;
+            return data;
+        }
+
+        const host_chain::table *rows() const
+        {
+            return host_chain::find_table(_code, _scope, uint64_t(TableName));
+        }
+
+        host_chain::index &index_rows(uint64_t index_name) const
+        {
+            return host_chain::get_index(_code, _scope, uint64_t(TableName), index_name);
+        }
+
+        template <size_t... N>
+        void add_secondary_keys(const T &obj, std::index_sequence<N...>)
+        {
+            (index_rows(index_at<N>::index_name).emplace(std::make_pair(index<N>::key_of(obj), obj.primary_key()), 0), ...);
+        }
+
+        template <size_t... N>
+        void remove_secondary_keys(const T &obj, std::index_sequence<N...>)
+        {
+            (index_rows(index_at<N>::index_name).erase({index<N>::key_of(obj), obj.primary_key()}), ...);
+        }
+
+        const item *item_of(const T &obj) const
+        {
+            for (auto i : _items)
+            {
+                if (&i->value == &obj)
+                {
+                    return i;
+                }
+            }
+            check(false, "object passed to iterator_to is not in multi_index");
+            return nullptr;
+        }
+
+        //A row read for the first time is deserialized into the cache, later reads are served from there
+        const item *load(uint64_t primary) const
+        {
+            for (auto i : _items)
+            {
+                if (i->primary_key == primary)
+                {
+                    return i;
+                }
+            }
+            const auto &row = rows()->at(primary);
+            auto i = new item();
+            datastream<const char *> ds(row.data.data(), row.data.size());
+            ds >> i->value;
+            i->primary_key = primary;
+            _items.push_back(i);
+            return i;
+        }
+
+        const item *next_item(uint64_t primary) const
+        {
+            auto table = rows();
+            auto it = table->upper_bound(primary);
+            return it == table->end() ? nullptr : load(it->first);
+        }
+
+        const item *previous_item(const item *i) const
+        {
+            auto table = rows();
+            check(table != nullptr && !table->empty(), "cannot decrement end iterator when the table is empty");
+            auto it = i == nullptr ? table->end() : table->find(i->primary_key);
+            check(it != table->begin(), "cannot decrement iterator at beginning of table");
+            --it;
+            return load(it->first);
+        }
+
+        name _code;
+        uint64_t _scope;
+        mutable uint64_t _next_primary_key = unset_next_primary_key;
+        mutable std::vector<item *> _items;
+    };
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include "multi_index.hpp"
+
+namespace eosio
+{
+    //One row table keyed by its own name, like the eosio.cdt singleton
+    template <name::raw SingletonName, typename T>
+    class singleton
+    {
+    private:
+        static constexpr uint64_t pk_value = uint64_t(SingletonName);
+
+        struct row
+        {
+            T value;
+
+            uint64_t primary_key() const
+            {
+                return pk_value;
+            }
+
+            EOSLIB_SERIALIZE(row, (value))
+        };
+
+        using table = multi_index<SingletonName, row>;
+
+    public:
+        singleton(name code, uint64_t scope) : _t(code, scope) {}
+
+        bool exists()
+        {
+            return _t.find(pk_value) != _t.end();
+        }
+
+        T get()
+        {
+            auto it = _t.find(pk_value);
+            check(it != _t.end(), "singleton does not exist");
+            return it->value;
+        }
+
+        T get_or_default(const T &def = T())
+        {
+            auto it = _t.find(pk_value);
+            return it != _t.end() ? it->value : def;
+        }
+
+        void set(const T &value, name bill_to_account)
+        {
+            auto it = _t.find(pk_value);
+            if (it != _t.end())
+            {
+                _t.modify(it, bill_to_account, [&](row &r) { r.value = value; });
+            }
+            else
+            {
+                _t.emplace(bill_to_account, [&](row &r) { r.value = value; });
+            }
+        }
+
+        void remove()
+        {
+            auto it = _t.find(pk_value);
+            if (it != _t.end())
+            {
+                _t.erase(it);
+            }
+        }
+
+    private:
+        table _t;
+    };
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include "time.hpp"
+#include "host_chain.hpp"
+
+namespace eosio
+{
+    inline time_point current_time_point()
+    {
+        return time_point(microseconds(int64_t(host_chain::now_us)));
+    }
+
+    inline bool is_account(name n)
+    {
+        return n.value != 0;
+    }
+}
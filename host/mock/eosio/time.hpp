@@ -0,0 +1,70 @@
+#pragma once
+#include "datastream.hpp"
+
+namespace eosio
+{
+    class microseconds
+    {
+    public:
+        explicit microseconds(int64_t c = 0) : _count(c) {}
+        int64_t count() const
+        {
+            return _count;
+        }
+        int64_t _count;
+
+        EOSLIB_SERIALIZE(microseconds, (_count))
+    };
+
+    inline microseconds seconds(int64_t s)
+    {
+        return microseconds(s * 1000000);
+    }
+
+    class time_point
+    {
+    public:
+        explicit time_point(microseconds e = microseconds()) : elapsed(e) {}
+        const microseconds &time_since_epoch() const
+        {
+            return elapsed;
+        }
+        uint32_t sec_since_epoch() const
+        {
+            return uint32_t(elapsed.count() / 1000000);
+        }
+        microseconds elapsed;
+
+        EOSLIB_SERIALIZE(time_point, (elapsed))
+    };
+
+    class time_point_sec
+    {
+    public:
+        time_point_sec() : utc_seconds(0) {}
+        explicit time_point_sec(uint32_t seconds) : utc_seconds(seconds) {}
+        time_point_sec(const time_point &t) : utc_seconds(t.sec_since_epoch()) {}
+
+        uint32_t sec_since_epoch() const
+        {
+            return utc_seconds;
+        }
+        operator time_point() const
+        {
+            return time_point(eosio::seconds(utc_seconds));
+        }
+
+        friend bool operator==(const time_point_sec &a, const time_point_sec &b)
+        {
+            return a.utc_seconds == b.utc_seconds;
+        }
+        friend bool operator<(const time_point_sec &a, const time_point_sec &b)
+        {
+            return a.utc_seconds < b.utc_seconds;
+        }
+
+        uint32_t utc_seconds;
+
+        EOSLIB_SERIALIZE(time_point_sec, (utc_seconds))
+    };
+}
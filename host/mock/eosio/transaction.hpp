@@ -0,0 +1,48 @@
+#pragma once
+#include "action.hpp"
+#include "time.hpp"
+
+namespace eosio
+{
+    struct transaction_header
+    {
+        time_point_sec expiration;
+        uint16_t ref_block_num = 0;
+        uint32_t ref_block_prefix = 0;
+        unsigned_int max_net_usage_words;
+        uint8_t max_cpu_usage_ms = 0;
+        unsigned_int delay_sec;
+
+        EOSLIB_SERIALIZE(transaction_header, (expiration)(ref_block_num)(ref_block_prefix)(max_net_usage_words)(max_cpu_usage_ms)(delay_sec))
+    };
+
+    struct transaction : transaction_header
+    {
+        std::vector<action> context_free_actions;
+        std::vector<action> actions;
+        std::vector<std::pair<uint16_t, std::vector<char>>> transaction_extensions;
+
+        template <typename DataStream>
+        friend DataStream &operator<<(DataStream &ds, const transaction &t)
+        {
+            return ds << static_cast<const transaction_header &>(t) << t.context_free_actions << t.actions << t.transaction_extensions;
+        }
+        template <typename DataStream>
+        friend DataStream &operator>>(DataStream &ds, transaction &t)
+        {
+            return ds >> static_cast<transaction_header &>(t) >> t.context_free_actions >> t.actions >> t.transaction_extensions;
+        }
+    };
+
+    inline size_t transaction_size()
+    {
+        return host_chain::transaction.size();
+    }
+
+    inline int read_transaction(char *buffer, size_t size)
+    {
+        auto n = std::min(size, host_chain::transaction.size());
+        std::memcpy(buffer, host_chain::transaction.data(), n);
+        return int(n);
+    }
+}
@@ -0,0 +1,326 @@
+//Prints the instrstats report of the main actions, and fails if one of them fails
+#include "host_actions.hpp"
+
+const token usdc{name("usdc.token"), symbol("USDC", 4)};
+
+//Zaps swap the share of the income that matches the pool ratio and add the rest, zapout does the reverse
+static void check_zaps(const uint64_t &pool_id, const symbol &lq_symbol)
+{
+    //On constant product the split has a closed form, so only rounding dust comes back
+    auto eos_in = extended_symbol(eos.sym, eos.contract);
+    auto before = lq_balance(bob, lq_symbol);
+    auto zap = swap_in(bob, eos, asset(1000000, eos.sym), "zap:" + std::to_string(pool_id));
+    auto lq = lq_balance(bob, lq_symbol) - before;
+    expect_true(lq > 0 && paid_amount(zap, bob, eos.sym) <= 100 && paid_amount(zap, bob, usdt.sym) == 0, "zap", "refunded more than dust");
+    print_stats("zap", zap);
+
+    //Too small to split, the swapped share is below the min swap amount
+    expect_transfer_fail("invalid min swap amount", bob, eos, asset(1000, eos.sym), "zap:" + std::to_string(pool_id));
+
+    expect_fail("zapout", "token is not matched with pool", self, {bob}, &swap::zap_out, {bob, asset(lq, lq_symbol), extended_symbol(usdc.sym, usdc.contract), uint64_t(1)});
+    expect_fail("zapout", "amount out less than min required", self, {bob}, &swap::zap_out, {bob, asset(lq, lq_symbol), eos_in, uint64_t(1000000)});
+    auto out = run("zapout", self, {bob}, &swap::zap_out, {bob, asset(lq, lq_symbol), eos_in, uint64_t(990000)});
+    expect_true(paid_amount(out, bob, eos.sym) >= 990000 && paid_amount(out, bob, usdt.sym) == 0, "zapout", "paid less than the min or left the other side unswapped");
+    print_stats("zapout", out);
+
+    //A share of the other side below the min swap amount is paid out as is
+    auto dust = run("zapout", self, {bob}, &swap::zap_out, {bob, asset(300, lq_symbol), eos_in, uint64_t(1)});
+    auto dust_out = paid_amount(dust, bob, usdt.sym);
+    expect_true(paid_amount(dust, bob, eos.sym) > 0 && dust_out > 0 && dust_out < min_swap_amount, "zapout", "dust side is not paid out as is");
+
+    //StableSwap has no closed form, the split is bisected on the curve and still leaves only dust
+    create_token(usdc);
+    for (const auto &owner : {alice, bob})
+    {
+        open_token_account(usdc, owner);
+    }
+    run("createpool", self, {alice}, &swap::create_pool, {alice, extended_symbol(usdt.sym, usdt.contract), extended_symbol(usdc.sym, usdc.contract)});
+    auto stable_pool = find_pool_id(usdt, usdc);
+    run("setcurve", self, {self}, &swap::set_curve, {stable_pool, uint8_t(curve_type::stable_swap), uint64_t(100)});
+    auto stable_lq = symbol(get_pool_code(stable_pool), 0);
+    run("open", self, {alice}, &swap::open, {alice, stable_lq, alice});
+    run("open", self, {bob}, &swap::open, {bob, stable_lq, bob});
+    deposit(alice, stable_pool, usdt, asset(10000000, usdt.sym), usdc, asset(12000000, usdc.sym));
+    auto stable_zap = swap_in(bob, usdt, asset(1000000, usdt.sym), "zap:" + std::to_string(stable_pool));
+    expect_true(lq_balance(bob, stable_lq) > 0 && paid_amount(stable_zap, bob, usdt.sym) <= 100 && paid_amount(stable_zap, bob, usdc.sym) <= 100,
+                "stable zap", "refunded more than dust");
+    print_stats("stable zap", stable_zap);
+}
+
+//createpools lists a batch of pairs under consecutive ids and rejects any pair listed twice or already listed
+static void check_create_pools()
+{
+    setup_chain();
+    const token cash{name("cash.token"), symbol("CASH", 4)};
+    create_token(cash);
+    create_token(usdc);
+    auto sym = [](const token &t) { return extended_symbol(t.sym, t.contract); };
+
+    expect_fail("createpools", "pair is duplicated in batch", self, {alice}, &swap::create_pools,
+                {alice, {{sym(cash), sym(usdc)}, {sym(eos), sym(cash)}, {sym(usdc), sym(cash)}}});
+    expect_fail("createpools", "pool already exist", self, {alice}, &swap::create_pools, {alice, {{sym(cash), sym(usdc)}, {sym(usdt), sym(eos)}}});
+    auto stats = run("createpools", self, {alice}, &swap::create_pools, {alice, {{sym(cash), sym(eos)}, {sym(usdc), sym(usdt)}, {sym(cash), sym(usdc)}}});
+    auto first = find_pool_id(cash, eos);
+    expect_true(find_pool_id(usdc, usdt) == first + 1 && find_pool_id(cash, usdc) == first + 2, "createpools", "pool ids are not consecutive");
+    print_stats("createpools", stats);
+}
+
+//openmany leaves rows that exist alone, closemany closes only zero balances
+static void check_open_close_many()
+{
+    auto [pool_id, lq1] = setup_chain();
+    const token cash{name("cash.token"), symbol("CASH", 4)};
+    create_token(cash);
+    run("createpool", self, {alice}, &swap::create_pool, {alice, extended_symbol(cash.sym, cash.contract), extended_symbol(eos.sym, eos.contract)});
+    auto lq2 = symbol(get_pool_code(find_pool_id(cash, eos)), 0);
+    run("open", self, {alice}, &swap::open, {alice, lq1, alice});
+    run("open", self, {bob}, &swap::open, {bob, lq1, bob});
+    deposit(alice, pool_id, asset(1000000, eos.sym), asset(4000000, usdt.sym));
+    run("transfer", self, {alice}, &swap::transfer_token, {alice, bob, asset(1000, lq1), std::string("lq")});
+
+    auto stats = run("openmany", self, {bob}, &swap::open_many, {bob, {lq1, lq2}, bob});
+    accounts bob_rows(self, bob.value);
+    auto accounts_writes = std::find_if(stats.tables.begin(), stats.tables.end(), [](const auto &t) { return t.table == name("accounts"); });
+    expect_true(lq_balance(bob, lq1) == 1000 && bob_rows.find(lq2.code().raw()) != bob_rows.end() && accounts_writes != stats.tables.end() &&
+                    accounts_writes->writes == 1,
+                "openmany", "an existing row is written again or the new row is missing");
+    print_stats("openmany", stats);
+
+    expect_fail("closemany", "balance is not zero", self, {bob}, &swap::close_many, {bob, {lq2, lq1}});
+    expect_true(bob_rows.find(lq2.code().raw()) != bob_rows.end(), "closemany", "a failed close left a row erased");
+    run("closemany", self, {bob}, &swap::close_many, {bob, {lq2}});
+    expect_true(bob_rows.find(lq2.code().raw()) == bob_rows.end() && lq_balance(bob, lq1) == 1000, "closemany", "wrong rows after closing");
+}
+
+//transfermany debits the sender once for the sum and credits each recipient
+static void check_transfer_many()
+{
+    auto [pool_id, lq1] = setup_chain();
+    const name carol("carol");
+    const token cash{name("cash.token"), symbol("CASH", 4)};
+    create_token(cash);
+    run("createpool", self, {alice}, &swap::create_pool, {alice, extended_symbol(cash.sym, cash.contract), extended_symbol(eos.sym, eos.contract)});
+    auto lq2 = symbol(get_pool_code(find_pool_id(cash, eos)), 0);
+    for (const auto &owner : {alice, bob, carol})
+    {
+        run("open", self, {owner}, &swap::open, {owner, lq1, owner});
+    }
+    deposit(alice, pool_id, asset(1000000, eos.sym), asset(4000000, usdt.sym));
+
+    expect_fail("transfermany", "all transfers must have the same symbol", self, {alice}, &swap::transfer_many,
+                {alice, {{bob, asset(1000, lq1), "lq"}, {carol, asset(1000, lq2), "lq"}}});
+    auto before = lq_balance(alice, lq1);
+    auto stats = run("transfermany", self, {alice}, &swap::transfer_many, {alice, {{bob, asset(1000, lq1), "lq"}, {carol, asset(2500, lq1), "lq"}}});
+    expect_true(lq_balance(alice, lq1) == before - 3500 && lq_balance(bob, lq1) == 1000 && lq_balance(carol, lq1) == 2500,
+                "transfermany", "wrong balances after the transfers");
+    auto accounts_writes = std::find_if(stats.tables.begin(), stats.tables.end(), [](const auto &t) { return t.table == name("accounts"); });
+    expect_true(accounts_writes != stats.tables.end() && accounts_writes->writes == 3, "transfermany", "sender is not debited in one write");
+    print_stats("transfermany", stats);
+}
+
+//withdrawmany pays each token once, summed over the pools that share it
+static void check_withdraw_many()
+{
+    auto [pool_id, lq1] = setup_chain();
+    const token cash{name("cash.token"), symbol("CASH", 4)};
+    create_token(cash);
+    run("createpool", self, {alice}, &swap::create_pool, {alice, extended_symbol(cash.sym, cash.contract), extended_symbol(eos.sym, eos.contract)});
+    open_token_account(cash, alice);
+    auto cash_pool = find_pool_id(cash, eos);
+    auto lq2 = symbol(get_pool_code(cash_pool), 0);
+    run("open", self, {alice}, &swap::open, {alice, lq1, alice});
+    run("open", self, {alice}, &swap::open, {alice, lq2, alice});
+    deposit(alice, pool_id, asset(1000000, eos.sym), asset(4000000, usdt.sym));
+    deposit(alice, cash_pool, cash, asset(2000000, cash.sym), eos, asset(500000, eos.sym));
+
+    expect_fail("withdrawmany", "lq tokens must be unique", self, {alice}, &swap::withdraw_many, {alice, {asset(1000, lq1), asset(1000, lq1)}});
+    auto stats = run("withdrawmany", self, {alice}, &swap::withdraw_many, {alice, {asset(lq_balance(alice, lq1) / 2, lq1), asset(lq_balance(alice, lq2) / 2, lq2)}});
+    int64_t eos_out = 0;
+    for (const auto &act : stats.actions)
+    {
+        if (act.name == name("rmvlqdetails"))
+        {
+            auto [id, owner, lq, token1, token2] = unpack<std::tuple<uint64_t, name, asset, extended_asset, extended_asset>>(act.data);
+            eos_out += (token1.quantity.symbol == eos.sym ? token1 : token2).quantity.amount;
+        }
+    }
+    auto eos_transfers = std::count_if(stats.transfers.begin(), stats.transfers.end(), [](const auto &t) { return t.quantity.symbol == eos.sym; });
+    expect_true(stats.transfers.size() == 3 && eos_transfers == 1 && eos_out > 0 && paid_amount(stats, alice, eos.sym) == eos_out,
+                "withdrawmany", "EOS of both pools is not paid in one transfer");
+    print_stats("withdrawmany", stats);
+}
+
+//cleanup erases zero balances of dormant members and members left without balances, a small budget
+//takes several calls that each resume where the last one stopped
+static void check_cleanup()
+{
+    auto [pool_id, lq1] = setup_chain();
+    const token cash{name("cash.token"), symbol("CASH", 4)};
+    create_token(cash);
+    run("createpool", self, {alice}, &swap::create_pool, {alice, extended_symbol(cash.sym, cash.contract), extended_symbol(eos.sym, eos.contract)});
+    auto lq2 = symbol(get_pool_code(find_pool_id(cash, eos)), 0);
+
+    const name carol("carol");
+    const name dave("dave");
+    const name erin("erin");
+    run("open", self, {alice}, &swap::open, {alice, lq1, alice});
+    deposit(alice, pool_id, asset(1000000, eos.sym), asset(4000000, usdt.sym));
+    for (const auto &owner : {carol, dave})
+    {
+        run("open", self, {owner}, &swap::open, {owner, lq1, owner});
+        run("open", self, {owner}, &swap::open, {owner, lq2, owner});
+    }
+    run("transfer", self, {alice}, &swap::transfer_token, {alice, dave, asset(1000, lq1), std::string("lq")});
+    run("open", self, {erin}, &swap::open, {erin, lq1, erin});
+
+    //Everyone goes dormant but erin, who renews her date
+    host_chain::now_us += (uint64_t(max_inh_period) + 1) * 1000000;
+    run("updinhdate", self, {erin}, &swap::update_inheritance_date, {erin, max_inh_period});
+
+    expect_fail("cleanup", "invalid max rows", self, {bob}, &swap::cleanup, {bob, name(), symbol_code(), uint32_t(1)});
+    const uint32_t max_rows = 2;
+    name cursor;
+    symbol_code row_cursor;
+    uint32_t calls = 0;
+    uint32_t erased = 0;
+    bool resumed_in_member = false;
+    do
+    {
+        auto stats = run("cleanup", self, {bob}, &swap::cleanup, {bob, cursor, row_cursor, max_rows});
+        auto [keeper, next_cursor, next_row_cursor, rows_erased, bytes_freed] =
+            unpack_sent<std::tuple<name, name, symbol_code, uint32_t, uint64_t>>("cleanup", stats, name("cleanreport"));
+        expect_true(rows_erased <= max_rows, "cleanup", "erased more rows than its budget");
+        expect_true(rows_erased == 0 || bytes_freed > 0, "cleanup", "erased rows without freeing bytes");
+        resumed_in_member |= next_row_cursor.raw() != 0;
+        cursor = next_cursor;
+        row_cursor = next_row_cursor;
+        erased += rows_erased;
+        ++calls;
+    } while (cursor != name() && calls < 16);
+    expect_true(cursor == name() && calls > 1 && resumed_in_member, "cleanup", "cursor did not resume inside a member and run to the end");
+
+    //carol's zero rows and member row, and dave's zero LQ2 row
+    expect_true(erased == 4, "cleanup", "erased a wrong number of rows");
+    inheritance members(self, self.value);
+    accounts carol_rows(self, carol.value);
+    expect_true(carol_rows.begin() == carol_rows.end() && members.find(carol.value) == members.end(), "cleanup", "dormant member without balances is left");
+    accounts dave_rows(self, dave.value);
+    expect_true(dave_rows.find(lq2.code().raw()) == dave_rows.end() && dave_rows.get(lq1.code().raw()).balance.amount == 1000 &&
+                    members.find(dave.value) != members.end(),
+                "cleanup", "wrong rows of a dormant member with a balance");
+    expect_true(lq_balance(alice, lq1) > 0 && members.find(alice.value) != members.end(), "cleanup", "erased a balance");
+    accounts erin_rows(self, erin.value);
+    expect_true(erin_rows.find(lq1.code().raw()) != erin_rows.end() && members.find(erin.value) != members.end(), "cleanup", "erased rows of an active member");
+}
+
+int main()
+{
+    instr.paused = true;
+    auto [pool_id, lq_symbol] = setup_chain();
+
+    run("open", self, {alice}, &swap::open, {alice, lq_symbol, alice});
+    run("open", self, {bob}, &swap::open, {bob, lq_symbol, bob});
+    deposit(alice, pool_id, asset(10000000, eos.sym), asset(40000000, usdt.sym));
+
+    print_stats("deposit", deposit(alice, pool_id, asset(1000000, eos.sym), asset(4000000, usdt.sym)));
+    print_stats("transfer", run("transfer", self, {alice}, &swap::transfer_token, {alice, bob, asset(1000, lq_symbol), std::string("lq")}));
+    print_stats("withdraw", run("withdraw", self, {alice}, &swap::withdraw, {alice, asset(1000, lq_symbol)}));
+    print_stats("swap", swap_in(bob, eos, asset(10000, eos.sym), "swap:" + std::to_string(pool_id)));
+    //An exact output swap pays the asked amount and refunds the input it did not use
+    auto swap_out = swap_in(bob, eos, asset(20000, eos.sym), "swap:" + std::to_string(pool_id) + ";out:30000");
+    auto out_in = std::get<2>(unpack_sent<swap_details_args>("swap out", swap_out, name("swapdetails"))).quantity.amount;
+    expect_true(paid_amount(swap_out, bob, usdt.sym) == 30000 && out_in < 20000 && paid_amount(swap_out, bob, eos.sym) == 20000 - out_in,
+                "swap out", "wrong output or refund");
+    print_stats("swap out", swap_out);
+
+    //A partial fill swaps the largest part that keeps the price implied by min and refunds the rest
+    auto partial = swap_in(bob, eos, asset(500000, eos.sym), "swap:" + std::to_string(pool_id) + ";min:1960000;fill:partial");
+    auto filled = std::get<2>(unpack_sent<swap_details_args>("swap partial", partial, name("swapdetails"))).quantity.amount;
+    auto partial_out = paid_amount(partial, bob, usdt.sym);
+    expect_true(filled > 0 && filled < 500000 && (uint128_t)partial_out * 500000 >= (uint128_t)1960000 * filled &&
+                    paid_amount(partial, bob, eos.sym) == 500000 - filled,
+                "swap partial", "output below the min price or wrong refund");
+    print_stats("swap partial", partial);
+    run("regroute", self, {bob}, &swap::register_route, {bob, extended_symbol(usdt.sym, usdt.contract), {pool_id}});
+    print_stats("route swap", swap_in(bob, usdt, asset(40000, usdt.sym), "swap:r0;min:1"));
+    print_stats("swap again", swap_in(bob, usdt, asset(40000, usdt.sym), "swap:" + std::to_string(pool_id)));
+    //~AAEB is flags 0, min 1 and pool 1, the pool setup_chain creates
+    auto compact = swap_in(bob, usdt, asset(40000, usdt.sym), "~AAEB");
+    expect_sent("compact swap", compact, name("swapdetails"));
+    print_stats("compact swap", compact);
+
+    auto eos_in = extended_symbol(eos.sym, eos.contract);
+    auto usdt_in = extended_symbol(usdt.sym, usdt.contract);
+    run("vaultopen", self, {bob}, &swap::vault_open, {bob, eos_in, bob});
+    run("vaultopen", self, {bob}, &swap::vault_open, {bob, usdt_in, bob});
+    swap_in(bob, eos, asset(100000, eos.sym), "vault:bob");
+    auto vault_swap = run("swapexact", self, {bob}, &swap::swap_exact, {bob, extended_asset(10000, eos_in), {pool_id}, uint64_t(1)});
+    expect_sent("swapexact", vault_swap, name("swapdetails"));
+    print_stats("swapexact", vault_swap);
+
+    //Removing a pool erases the routes through it
+    const token cash{name("cash.token"), symbol("CASH", 4)};
+    create_token(cash);
+    run("createpool", self, {alice}, &swap::create_pool, {alice, extended_symbol(cash.sym, cash.contract), eos_in});
+    auto cash_pool = pool_id + 1;
+    //Curves change only before the first deposit, and StableSwap never runs on empty reserves
+    expect_fail("setcurve", "pool is not empty", self, {self}, &swap::set_curve, {pool_id, uint8_t(curve_type::stable_swap), uint64_t(100)});
+    run("setcurve", self, {self}, &swap::set_curve, {cash_pool, uint8_t(curve_type::stable_swap), uint64_t(100)});
+    expect_fail("swapexact", "pool has no liquidity", self, {bob}, &swap::swap_exact, {bob, extended_asset(10000, eos_in), {cash_pool}, uint64_t(1)});
+    run("regroute", self, {bob}, &swap::register_route, {bob, eos_in, {cash_pool}});
+    print_stats("removepool", run("removepool", self, {}, &swap::remove_pool, {cash_pool}));
+    routes route_rows(self, self.value);
+    route_refs ref_rows(self, cash_pool);
+    if (route_rows.find(1) != route_rows.end() || ref_rows.begin() != ref_rows.end())
+    {
+        std::printf("removepool : route through the removed pool is left\n");
+        return 1;
+    }
+    //The route cap is per owner, bob filling his leaves alice free to register through the same pool
+    for (uint8_t i = 1; i < max_pool_routes; ++i)
+    {
+        run("regroute", self, {bob}, &swap::register_route, {bob, usdt_in, {pool_id}});
+    }
+    expect_fail("regroute", "too many routes", self, {bob}, &swap::register_route, {bob, usdt_in, {pool_id}});
+    run("regroute", self, {alice}, &swap::register_route, {alice, usdt_in, {pool_id}});
+
+    pool_seqs seq_rows(self, self.value);
+    auto removed = seq_rows.find(cash_pool);
+    if (removed == seq_rows.end() || !removed->removed)
+    {
+        std::printf("removepool : pool is not stamped as removed\n");
+        return 1;
+    }
+
+    //The first swap of a new hour moves the previous hour's volume into the poolvolume ring
+    host_chain::now_us += uint64_t(volume_bucket_period) * 1000000;
+    print_stats("swap next hour", swap_in(bob, eos, asset(10000, eos.sym), "swap:" + std::to_string(pool_id)));
+    if (seq_rows.get(pool_id).seq != host_chain::now_us)
+    {
+        std::printf("swap : pool is not stamped with the block time\n");
+        return 1;
+    }
+
+    //Past the inactive period alice's LQ balance goes to her inheritors
+    host_chain::now_us += (uint64_t(max_inh_period) + 1) * 1000000;
+    print_stats("dstrinh", run("dstrinh", self, {bob}, &swap::distribute_inheritance, {bob, alice, lq_symbol.code()}));
+
+    //An account that opted out sends no swapdetails until the contract's own row forces them on for indexers
+    run("setntfpolicy", self, {bob}, &swap::set_notify_policy, {bob, false, false, false});
+    auto quiet = swap_in(bob, eos, asset(10000, eos.sym), "swap:" + std::to_string(pool_id));
+    if (std::find(quiet.sent.begin(), quiet.sent.end(), name("swapdetails")) != quiet.sent.end())
+    {
+        std::fprintf(stderr, "swap sent swapdetails for an account that opted out\n");
+        return 1;
+    }
+    run("setntfpolicy", self, {self}, &swap::set_notify_policy, {self, true, true, true});
+    expect_sent("swap", swap_in(bob, eos, asset(10000, eos.sym), "swap:" + std::to_string(pool_id)), name("swapdetails"));
+
+    check_zaps(pool_id, lq_symbol);
+    check_cleanup();
+    check_withdraw_many();
+    check_transfer_many();
+    check_open_close_many();
+    check_create_pools();
+    return 0;
+}
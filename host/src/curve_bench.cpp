@@ -0,0 +1,81 @@
+#include "curve.hpp"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+struct bench_options
+{
+    uint64_t swaps = 1000000;
+    uint64_t seed = 42;
+};
+
+struct swap_case
+{
+    int64_t reserve_in;
+    int64_t reserve_out;
+    int64_t amount;
+};
+
+//Runs one kernel over every case and returns nanoseconds per call, the sum keeps the calls from being dropped
+template <typename Kernel>
+static double time_kernel(const std::vector<swap_case> &cases, int64_t &sum, Kernel &&kernel)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (const auto &c : cases)
+    {
+        sum += kernel(c);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() * 1e9 / cases.size();
+}
+
+int main(int argc, char **argv)
+{
+    bench_options options;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string arg = argv[i];
+        std::string value = argv[i + 1];
+        if (arg == "-n")
+            options.swaps = std::stoull(value);
+        else if (arg == "-s")
+            options.seed = std::stoull(value);
+    }
+
+    //Reserves from 10^6 to 10^12 with up to 5:1 imbalance, trades up to a fifth of the output reserve
+    std::mt19937_64 rng(options.seed);
+    std::vector<swap_case> cases(options.swaps);
+    for (auto &c : cases)
+    {
+        c.reserve_in = 1000000 + rng() % 1000000000000ll;
+        c.reserve_out = (int64_t)(c.reserve_in * (0.2 + (rng() % 1000) / 250.0));
+        c.amount = 1 + rng() % (c.reserve_out / 5);
+    }
+
+    int64_t sum = 0;
+    std::printf("%llu swaps, seed %llu\n", (unsigned long long)options.swaps, (unsigned long long)options.seed);
+    std::printf("%-24s %10s %10s\n", "curve", "out ns", "in ns");
+    auto out_ns = time_kernel(cases, sum, [](const swap_case &c) {
+        return constant_product::get_amount_out(c.reserve_in, c.reserve_out, c.amount, 0);
+    });
+    auto in_ns = time_kernel(cases, sum, [](const swap_case &c) {
+        return (int64_t)constant_product::get_amount_in(c.reserve_in, c.reserve_out, c.amount, 0);
+    });
+    std::printf("%-24s %10.1f %10.1f\n", "constant_product", out_ns, in_ns);
+
+    for (uint64_t amp : {(uint64_t)1, (uint64_t)100, max_stable_amp})
+    {
+        out_ns = time_kernel(cases, sum, [amp](const swap_case &c) {
+            return stable_swap::get_amount_out(c.reserve_in, c.reserve_out, c.amount, amp);
+        });
+        in_ns = time_kernel(cases, sum, [amp](const swap_case &c) {
+            return (int64_t)stable_swap::get_amount_in(c.reserve_in, c.reserve_out, c.amount, amp);
+        });
+        auto label = "stable_swap amp " + std::to_string(amp);
+        std::printf("%-24s %10.1f %10.1f\n", label.c_str(), out_ns, in_ns);
+    }
+    std::printf("checksum %lld\n", (long long)sum);
+    return 0;
+}
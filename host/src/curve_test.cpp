@@ -0,0 +1,78 @@
+//curve.hpp goes first, so this file only compiles while the header needs nothing beyond <cmath> and <cstdint>
+#include "curve.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+static int failures = 0;
+
+static void expect(bool pred, const char *msg, long long a, long long b)
+{
+    if (!pred)
+    {
+        std::fprintf(stderr, "FAIL %s: %lld vs %lld\n", msg, a, b);
+        ++failures;
+    }
+}
+
+//get_amount_in is the inverse of get_amount_out: paying the rounded up input returns the requested output
+//within the two units the integer rounding of get_amount_out can lose
+template <typename Curve>
+static void test_inverse(const char *curve)
+{
+    std::mt19937_64 rng(7);
+    for (int i = 0; i < 100000; ++i)
+    {
+        int64_t reserve_in = 1000 + rng() % 1000000000000ll;
+        int64_t reserve_out = (int64_t)(reserve_in * (0.2 + (rng() % 1000) / 625.0));
+        uint64_t amp = 1 + rng() % max_stable_amp;
+        int64_t amount_out = 1 + rng() % (reserve_out / 2);
+
+        auto amount_in = (int64_t)std::ceil(Curve::get_amount_in(reserve_in, reserve_out, amount_out, amp));
+        auto back = Curve::get_amount_out(reserve_in, reserve_out, amount_in, amp);
+        expect(std::llabs(back - amount_out) <= 2, curve, back, amount_out);
+    }
+}
+
+//On a balanced pool a StableSwap trade pays at least the constant product amount and at most the amount in.
+//It moves towards constant product as amp falls and towards a 1:1 constant sum as amp grows.
+//Amp is at least 1 on chain, so the constant product limit itself is only checked as a direction.
+static void test_amp_limits()
+{
+    const int64_t reserve = 1000000000;
+    for (auto amount_in : {1000000ll, 10000000ll, 100000000ll, 500000000ll})
+    {
+        auto product = constant_product::get_amount_out(reserve, reserve, amount_in, 0);
+        auto prev = product;
+        for (uint64_t amp = 1; amp <= max_stable_amp; amp *= 10)
+        {
+            auto stable = stable_swap::get_amount_out(reserve, reserve, amount_in, amp);
+            expect(stable >= product, "stable below constant product", stable, product);
+            expect(stable <= amount_in, "stable above constant sum", stable, amount_in);
+            expect(stable >= prev, "stable not monotonic in amp", stable, prev);
+            prev = stable;
+        }
+
+        //At the highest amp a trade up to a tenth of the reserve is priced 1:1 within 0.001%
+        if (amount_in <= reserve / 10)
+        {
+            auto high = stable_swap::get_amount_out(reserve, reserve, amount_in, max_stable_amp);
+            expect((double)(amount_in - high) <= 1e-5 * (double)amount_in, "max amp far from constant sum", high, amount_in);
+        }
+    }
+}
+
+int main()
+{
+    test_inverse<constant_product>("constant product inverse");
+    test_inverse<stable_swap>("stable swap inverse");
+    test_amp_limits();
+
+    if (failures > 0)
+    {
+        std::fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    std::printf("curve checks passed\n");
+    return 0;
+}
@@ -0,0 +1,366 @@
+#pragma once
+//Runs contract actions natively against the stand-in eosio headers and decodes the instrstats report of each,
+//so db calls and heap bytes per action can be compared between builds without a chain
+#define INSTRUMENT
+#include "../../swap.pcash/swap.pcash.cpp"
+#include <chrono>
+#include <cstdio>
+
+struct action_stats
+{
+    std::vector<instr_table_counters> tables;
+    uint32_t inline_actions = 0;
+    std::vector<instr_phase_heap> heap;
+    uint32_t peak_heap_bytes = 0;
+    uint32_t page_growth = 0;
+    uint32_t arena_bytes = 0;
+    std::vector<name> sent;
+    std::vector<eosio::action> actions;
+    //Transfers sent to token contracts, the contract's own LQ transfers have already run
+    std::vector<transfer_action> transfers;
+    double ns = 0;
+};
+
+struct token
+{
+    name contract;
+    symbol sym;
+};
+
+const name self("swap.pcash");
+const name alice("alice");
+const name bob("bob");
+const token eos{name("eosio.token"), symbol("EOS", 4)};
+const token usdt{name("tethertether"), symbol("USDT", 4)};
+
+//Wall time of the last top level action, from the contract constructor to its destructor
+inline double last_action_ns = 0;
+
+//Builds from the contract only an instrstats report it sent, earlier layouts without the trailing fields still decode
+inline bool decode_stats(const eosio::action &act, action_stats &stats)
+{
+    if (act.account != self || act.name != name("instrstats"))
+    {
+        return false;
+    }
+    datastream<const char *> ds(act.data.data(), act.data.size());
+    name code;
+    ds >> code >> stats.tables >> stats.inline_actions >> stats.heap;
+    if (ds.remaining() > 0)
+    {
+        ds >> stats.peak_heap_bytes >> stats.page_growth >> stats.arena_bytes;
+    }
+    return true;
+}
+
+template <typename... Args>
+inline std::vector<eosio::action> call(const name &code, const name &sender, const std::vector<name> &auths,
+                                       void (swap::*method)(const Args &...), const std::tuple<Args...> &args);
+
+//Token actions the contract sends itself change balances later steps rely on, so they run like on chain
+inline void run_inline(const eosio::action &act)
+{
+    std::vector<name> auths;
+    for (const auto &auth : act.authorization)
+    {
+        auths.push_back(auth.actor);
+    }
+    if (act.name == name("issue"))
+    {
+        call(self, self, auths, &swap::issue, unpack<std::tuple<name, asset, std::string>>(act.data));
+    }
+    else if (act.name == name("retire"))
+    {
+        call(self, self, auths, &swap::retire, unpack<std::tuple<name, asset, std::string>>(act.data));
+    }
+    else if (act.name == name("transfer"))
+    {
+        call(self, self, auths, &swap::transfer_token, unpack<std::tuple<name, name, asset, std::string>>(act.data));
+    }
+}
+
+//Returns the inline actions the action sent itself, the ones it sent to the contract have already run
+template <typename... Args>
+inline std::vector<eosio::action> call(const name &code, const name &sender, const std::vector<name> &auths,
+                                       void (swap::*method)(const Args &...), const std::tuple<Args...> &args)
+{
+    host_chain::self = self;
+    host_chain::sender = sender;
+    host_chain::auths.assign(auths.begin(), auths.end());
+    host_chain::inline_actions.clear();
+    host_chain::recipients.clear();
+#if __has_include("arena.hpp")
+    scratch = scratch_arena();
+#endif
+
+    //Every action starts in a fresh instance, the harness keeps its own allocations out of the counters
+    instr = instrument_state();
+    auto start = std::chrono::steady_clock::now();
+    {
+        swap contract(self, code, datastream<const char *>(nullptr, 0));
+        std::apply([&](const auto &... a) { (contract.*method)(a...); }, args);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    instr.paused = true;
+    last_action_ns = elapsed.count() * 1e9;
+
+    std::vector<eosio::action> actions;
+    for (const auto &bytes : host_chain::inline_actions)
+    {
+        actions.push_back(unpack<eosio::action>(bytes.data(), bytes.size()));
+    }
+    for (const auto &act : actions)
+    {
+        if (act.account == self)
+        {
+            run_inline(act);
+        }
+    }
+    return actions;
+}
+
+//Runs a top level action and reverts the tables if it fails
+template <typename... Args>
+inline action_stats run(const char *label, const name &code, const std::vector<name> &auths,
+                        void (swap::*method)(const Args &...), const std::common_type_t<std::tuple<Args...>> &args)
+{
+    auto db = host_chain::db;
+    auto index_db = host_chain::index_db;
+    action_stats stats;
+    std::vector<eosio::action> sent;
+    try
+    {
+        sent = call(code, name(), auths, method, args);
+        stats.ns = last_action_ns;
+    }
+    catch (const eosio::assert_error &e)
+    {
+        instr.paused = true;
+        host_chain::db = db;
+        host_chain::index_db = index_db;
+        std::fprintf(stderr, "%s failed: %s\n", label, e.what());
+        std::exit(1);
+    }
+
+    for (const auto &act : sent)
+    {
+        decode_stats(act, stats);
+        stats.sent.push_back(act.name);
+        stats.actions.push_back(act);
+        if (act.account != self && act.name == name("transfer"))
+        {
+            stats.transfers.push_back(unpack<transfer_action>(act.data));
+        }
+    }
+    return stats;
+}
+
+//Runs a top level action that has to fail with the given message, the tables are left as they were
+template <typename... Args>
+inline void expect_fail(const char *label, const char *message, const name &code, const std::vector<name> &auths,
+                        void (swap::*method)(const Args &...), const std::common_type_t<std::tuple<Args...>> &args)
+{
+    auto db = host_chain::db;
+    auto index_db = host_chain::index_db;
+    try
+    {
+        call(code, name(), auths, method, args);
+    }
+    catch (const eosio::assert_error &e)
+    {
+        instr.paused = true;
+        host_chain::db = db;
+        host_chain::index_db = index_db;
+        if (std::string_view(e.what()).find(message) != std::string_view::npos)
+        {
+            return;
+        }
+        std::fprintf(stderr, "%s failed with \"%s\" instead of \"%s\"\n", label, e.what(), message);
+        std::exit(1);
+    }
+    std::fprintf(stderr, "%s did not fail with \"%s\"\n", label, message);
+    std::exit(1);
+}
+
+inline void expect_sent(const char *label, const action_stats &stats, const name &action)
+{
+    if (std::find(stats.sent.begin(), stats.sent.end(), action) == stats.sent.end())
+    {
+        std::fprintf(stderr, "%s sent no %s\n", label, action.to_string().c_str());
+        std::exit(1);
+    }
+}
+
+using swap_details_args = std::tuple<uint64_t, name, extended_asset, extended_asset, extended_asset, extended_asset, double>;
+
+//Arguments of the first action of the given name the contract sent itself
+template <typename Args>
+inline Args unpack_sent(const char *label, const action_stats &stats, const name &action)
+{
+    for (const auto &act : stats.actions)
+    {
+        if (act.account == self && act.name == action)
+        {
+            return unpack<Args>(act.data);
+        }
+    }
+    std::fprintf(stderr, "%s sent no %s\n", label, action.to_string().c_str());
+    std::exit(1);
+}
+
+inline void expect_true(bool pred, const char *label, const char *message)
+{
+    if (!pred)
+    {
+        std::fprintf(stderr, "%s : %s\n", label, message);
+        std::exit(1);
+    }
+}
+
+//Sum of the transfers of one symbol the action paid to an account
+inline int64_t paid_amount(const action_stats &stats, const name &to, const symbol &sym)
+{
+    int64_t amount = 0;
+    for (const auto &t : stats.transfers)
+    {
+        if (t.to == to && t.quantity.symbol == sym)
+        {
+            amount += t.quantity.amount;
+        }
+    }
+    return amount;
+}
+
+inline void print_stats(const char *label, const action_stats &stats)
+{
+    instr_table_counters total;
+    std::printf("%s\n", label);
+    std::printf("  %-12s %6s %6s %6s %6s\n", "table", "reads", "writes", "index", "hits");
+    for (const auto &t : stats.tables)
+    {
+        std::printf("  %-12s %6u %6u %6u %6u\n", t.table.to_string().c_str(), t.reads, t.writes, t.index_ops, t.cache_hits);
+        total.reads += t.reads;
+        total.writes += t.writes;
+        total.index_ops += t.index_ops;
+        total.cache_hits += t.cache_hits;
+    }
+    std::printf("  %-12s %6u %6u %6u %6u\n", "total", total.reads, total.writes, total.index_ops, total.cache_hits);
+    std::printf("  inline actions %u, peak heap %u, arena %u, heap", stats.inline_actions, stats.peak_heap_bytes, stats.arena_bytes);
+    uint32_t heap = 0;
+    for (const auto &h : stats.heap)
+    {
+        std::printf(" %s %u", h.phase.to_string().c_str(), h.heap_bytes);
+        heap += h.heap_bytes;
+    }
+    std::printf(", total %u\n", heap);
+}
+
+//Token contracts the pools trade are not run, their stat rows are written directly so create_pool finds them
+inline void create_token(const token &t)
+{
+    currency_stats st{asset(1000000000000, t.sym), asset(100000000000000, t.sym), t.contract};
+    auto data = pack(st);
+    auto &table = host_chain::get_table(t.contract, t.sym.code().raw(), name("stat").value);
+    table[t.sym.code().raw()] = host_chain::row{t.contract.value, host_chain::bytes(data.begin(), data.end())};
+}
+
+//Withdrawals pay out only to owners holding a balance row in the token contract
+inline void open_token_account(const token &t, const name &owner)
+{
+    auto data = pack(account{asset(1000000000, t.sym)});
+    auto &table = host_chain::get_table(t.contract, owner.value, name("accounts").value);
+    table[t.sym.code().raw()] = host_chain::row{owner.value, host_chain::bytes(data.begin(), data.end())};
+}
+
+inline host_chain::bytes pack_transaction(const std::vector<std::tuple<token, name, asset, std::string>> &transfers)
+{
+    transaction trx;
+    for (const auto &[t, from, quantity, memo] : transfers)
+    {
+        trx.actions.push_back(eosio::action(permission_level{from, name("active")}, t.contract, name("transfer"),
+                                            std::make_tuple(from, self, quantity, memo)));
+    }
+    auto data = pack(trx);
+    return host_chain::bytes(data.begin(), data.end());
+}
+
+//Both deposit transfers go in one transaction, the second one adds the liquidity
+inline action_stats deposit(const name &owner, const uint64_t &pool_id, const token &t1, const asset &amount1, const token &t2, const asset &amount2)
+{
+    auto memo = "deposit:" + std::to_string(pool_id);
+    host_chain::transaction = pack_transaction({{t1, owner, amount1, memo}, {t2, owner, amount2, memo}});
+    run("deposit", t1.contract, {owner}, &swap::on_transfer, {owner, self, amount1, memo});
+    return run("deposit", t2.contract, {owner}, &swap::on_transfer, {owner, self, amount2, memo});
+}
+
+inline action_stats deposit(const name &owner, const uint64_t &pool_id, const asset &amount1, const asset &amount2)
+{
+    return deposit(owner, pool_id, eos, amount1, usdt, amount2);
+}
+
+inline action_stats swap_in(const name &owner, const token &t, const asset &quantity, const std::string &memo)
+{
+    host_chain::transaction = pack_transaction({{t, owner, quantity, memo}});
+    return run("swap", t.contract, {owner}, &swap::on_transfer, {owner, self, quantity, memo});
+}
+
+//A transfer in that has to be rejected with the given message
+inline void expect_transfer_fail(const char *message, const name &owner, const token &t, const asset &quantity, const std::string &memo)
+{
+    host_chain::transaction = pack_transaction({{t, owner, quantity, memo}});
+    expect_fail(memo.c_str(), message, t.contract, {owner}, &swap::on_transfer, {owner, self, quantity, memo});
+}
+
+inline int64_t lq_balance(const name &owner, const symbol &lq_symbol)
+{
+    accounts rows(self, owner.value);
+    auto it = rows.find(lq_symbol.code().raw());
+    return it == rows.end() ? 0 : it->balance.amount;
+}
+
+inline symbol_code get_pool_code(const uint64_t &pool_id)
+{
+    multi_index<name("pools"), pool> pool_rows(self, self.value);
+    return pool_rows.get(pool_id).code;
+}
+
+inline uint64_t find_pool_id(const token &t1, const token &t2)
+{
+    multi_index<name("pools"), pool> pool_rows(self, self.value);
+    for (const auto &row : pool_rows)
+    {
+        if (row.token1.get_extended_symbol() == extended_symbol(t1.sym, t1.contract) && row.token2.get_extended_symbol() == extended_symbol(t2.sym, t2.contract))
+        {
+            return row.id;
+        }
+    }
+    std::fprintf(stderr, "no pool of %s and %s\n", t1.sym.code().to_string().c_str(), t2.sym.code().to_string().c_str());
+    std::exit(1);
+}
+
+struct test_pool
+{
+    uint64_t id;
+    symbol lq_symbol;
+};
+
+//Fresh chain with the two tokens, alice and bob holding token balances and one pool between the tokens
+inline test_pool setup_chain()
+{
+    host_chain::db.clear();
+    host_chain::index_db.clear();
+    create_token(eos);
+    create_token(usdt);
+    for (const auto &owner : {alice, bob})
+    {
+        open_token_account(eos, owner);
+        open_token_account(usdt, owner);
+    }
+
+    run("createpool", self, {alice}, &swap::create_pool,
+        {alice, extended_symbol(eos.sym, eos.contract), extended_symbol(usdt.sym, usdt.contract)});
+    multi_index<name("pools"), pool> pool_rows(self, self.value);
+    const auto &row = *pool_rows.begin();
+    return test_pool{row.id, symbol(row.code, 0)};
+}
+
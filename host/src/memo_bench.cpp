@@ -0,0 +1,184 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "compact_memo.hpp"
+
+struct bench_options
+{
+    uint64_t swaps = 1000000;
+    uint64_t pools = 10000;
+    uint64_t max_hops = 3;
+    uint64_t seed = 42;
+};
+
+static void check(bool pred, const char *msg)
+{
+    if (!pred)
+    {
+        throw std::runtime_error(msg);
+    }
+}
+
+static void append_varint(std::vector<uint8_t> &bytes, uint64_t value)
+{
+    do
+    {
+        uint8_t byte = value & 0x7f;
+        value >>= 7;
+        bytes.push_back(value ? byte | 0x80 : byte);
+    } while (value);
+}
+
+static std::string encode_compact_memo(const compact_swap &swap)
+{
+    static const char *alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+    std::vector<uint8_t> bytes;
+    append_varint(bytes, swap.flags);
+    append_varint(bytes, swap.min_amount);
+    for (uint8_t i = 0; i < swap.pool_count; ++i)
+    {
+        append_varint(bytes, swap.pool_ids[i]);
+    }
+
+    std::string memo(compact_prefix);
+    uint32_t bits = 0;
+    uint8_t bit_count = 0;
+    for (auto byte : bytes)
+    {
+        bits = (bits << 8) | byte;
+        bit_count += 8;
+        while (bit_count >= 6)
+        {
+            bit_count -= 6;
+            memo += alphabet[(bits >> bit_count) & 0x3f];
+        }
+    }
+    if (bit_count > 0)
+    {
+        memo += alphabet[(bits << (6 - bit_count)) & 0x3f];
+    }
+    return memo;
+}
+
+static std::string encode_text_memo(const compact_swap &swap)
+{
+    std::string memo = "swap:";
+    for (uint8_t i = 0; i < swap.pool_count; ++i)
+    {
+        if (i > 0)
+        {
+            memo += '-';
+        }
+        memo += std::to_string(swap.pool_ids[i]);
+    }
+    memo += ";min:" + std::to_string(swap.min_amount);
+    if (swap.flags & compact_partial_fill)
+    {
+        memo += ";fill:partial";
+    }
+    return memo;
+}
+
+static uint64_t varuint32_size(uint64_t value)
+{
+    uint64_t size = 1;
+    while (value >>= 7)
+    {
+        ++size;
+    }
+    return size;
+}
+
+//Packed size of the token transfer action carrying the memo: account, name, one authorization and the data
+static uint64_t transfer_action_size(const std::string &memo)
+{
+    auto data = 8 + 8 + 16 + varuint32_size(memo.size()) + memo.size();
+    return 8 + 8 + 1 + 16 + varuint32_size(data) + data;
+}
+
+int main(int argc, char **argv)
+{
+    bench_options options;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string arg = argv[i];
+        std::string value = argv[i + 1];
+        if (arg == "-n")
+            options.swaps = std::stoull(value);
+        else if (arg == "-p")
+            options.pools = std::stoull(value);
+        else if (arg == "-l")
+            options.max_hops = std::stoull(value);
+        else if (arg == "-s")
+            options.seed = std::stoull(value);
+    }
+
+    try
+    {
+        check(options.swaps > 0 && options.pools > 0, "main : invalid options");
+        check(options.max_hops > 0 && options.max_hops <= max_route_length, "main : invalid max hops");
+
+        //Uniform routes of 1 to max hops over the pool ids, min amounts up to 10^10, one swap in ten partial
+        std::mt19937_64 rng(options.seed);
+        std::vector<compact_swap> swaps(options.swaps);
+        for (auto &swap : swaps)
+        {
+            swap.pool_count = 1 + rng() % options.max_hops;
+            for (uint8_t i = 0; i < swap.pool_count; ++i)
+            {
+                swap.pool_ids[i] = 1 + rng() % options.pools;
+            }
+            swap.min_amount = 1 + rng() % 10000000000ull;
+            swap.flags = rng() % 10 == 0 ? compact_partial_fill : 0;
+        }
+
+        uint64_t text_memo = 0, text_action = 0, compact_memo = 0, compact_action = 0;
+        std::vector<std::string> memos;
+        memos.reserve(swaps.size());
+        for (const auto &swap : swaps)
+        {
+            auto text = encode_text_memo(swap);
+            auto compact = encode_compact_memo(swap);
+            text_memo += text.size();
+            text_action += transfer_action_size(text);
+            compact_memo += compact.size();
+            compact_action += transfer_action_size(compact);
+            memos.push_back(std::move(compact));
+        }
+
+        uint64_t checksum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < memos.size(); ++i)
+        {
+            compact_swap decoded{};
+            check(decode_compact_memo(memos[i], decoded), "main : compact memo does not decode");
+            check(decoded.flags == swaps[i].flags && decoded.min_amount == swaps[i].min_amount && decoded.pool_count == swaps[i].pool_count,
+                  "main : compact memo decodes to another swap");
+            for (uint8_t j = 0; j < decoded.pool_count; ++j)
+            {
+                check(decoded.pool_ids[j] == swaps[i].pool_ids[j], "main : compact memo decodes to another route");
+            }
+            checksum += decoded.min_amount;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        auto count = (double)options.swaps;
+        std::printf("%llu swaps, %llu pools, 1-%llu hops, seed %llu\n", (unsigned long long)options.swaps,
+                    (unsigned long long)options.pools, (unsigned long long)options.max_hops, (unsigned long long)options.seed);
+        std::printf("%8s %12s %14s\n", "memo", "memo bytes", "action bytes");
+        std::printf("%8s %12.2f %14.2f\n", "text", text_memo / count, text_action / count);
+        std::printf("%8s %12.2f %14.2f\n", "compact", compact_memo / count, compact_action / count);
+        std::printf("NET saved per swap: %.2f bytes (%.1f%% of the action)\n", (text_action - compact_action) / count,
+                    100.0 * (text_action - compact_action) / text_action);
+        std::printf("compact decode: %.1f ns/memo (checksum %llu)\n", elapsed.count() * 1e9 / count, (unsigned long long)checksum);
+    }
+    catch (const std::exception &e)
+    {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,69 @@
+//compact_memo.hpp goes first, so this file only compiles while the header needs nothing beyond standard headers
+#include "compact_memo.hpp"
+#include <cstdio>
+#include <initializer_list>
+
+static int failures = 0;
+
+static void expect(bool pred, const char *msg, const std::string_view &memo)
+{
+    if (!pred)
+    {
+        std::fprintf(stderr, "FAIL %s: %.*s\n", msg, (int)memo.size(), memo.data());
+        ++failures;
+    }
+}
+
+static void expect_decoded(const std::string_view &memo, uint8_t flags, uint64_t min_amount, std::initializer_list<uint64_t> pool_ids)
+{
+    compact_swap swap;
+    expect(decode_compact_memo(memo, swap), "valid memo rejected", memo);
+    expect(swap.flags == flags && swap.min_amount == min_amount && swap.pool_count == pool_ids.size(), "memo decoded wrong", memo);
+    uint8_t i = 0;
+    for (auto pool_id : pool_ids)
+    {
+        expect(i < swap.pool_count && swap.pool_ids[i] == pool_id, "pool id decoded wrong", memo);
+        ++i;
+    }
+}
+
+static void expect_rejected(const std::string_view &memo)
+{
+    compact_swap swap;
+    expect(!decode_compact_memo(memo, swap), "malformed memo accepted", memo);
+}
+
+int main()
+{
+    //Memos of 2, 3 and 0 digits modulo 4, so with 4, 2 and no padding bits
+    expect_decoded("~AJWa7zoM6Qa7Ig", 0, 123456789, {12, 873, 4411});
+    expect_decoded("~AawCrAI", 1, 300, {300});
+    expect_decoded("~AQUH", 1, 5, {7});
+    expect_decoded("~AAEM6Qa7IgEC", 0, 1, {12, 873, 4411, 1, 2});
+    expect_decoded("~AP___________wEH", 0, UINT64_MAX, {7});
+    expect_decoded("~AAUH", 0, 5, {7});
+
+    //Each memo has one encoding: padding bits are zero and no digit is left over once the last byte is complete
+    expect_rejected("~AJWa7zoM6Qa7Ih");
+    expect_rejected("~AawCrAJ");
+    expect_rejected("~AQUHA");
+    expect_rejected("~AAEM6Qa7IgECA");
+    expect_rejected("~AAEM6Qa7IgEC_");
+
+    //Varints are minimal: ~AAUH again with the flags and then the min amount padded by a zero group
+    expect_rejected("~gAAFBw");
+    expect_rejected("~AIUABw");
+
+    //Unknown flags, a varint above uint64 and a memo without pool ids
+    expect_rejected("~AgUH");
+    expect_rejected("~AP___________wIH");
+    expect_rejected("~AAU");
+
+    if (failures > 0)
+    {
+        std::fprintf(stderr, "%d failures\n", failures);
+        return 1;
+    }
+    std::printf("memo_test passed\n");
+    return 0;
+}
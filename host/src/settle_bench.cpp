@@ -0,0 +1,232 @@
+//Compares settling N swap intents in one batch with the same N trades done one by one through swapexact
+#include "host_actions.hpp"
+#include <string>
+
+struct bench_totals
+{
+    uint32_t reads = 0;
+    uint32_t writes = 0;
+    uint32_t inline_actions = 0;
+    uint32_t heap_bytes = 0;
+    double ns = 0;
+
+    void add(const action_stats &stats)
+    {
+        for (const auto &t : stats.tables)
+        {
+            reads += t.reads + t.index_ops;
+            writes += t.writes;
+        }
+        for (const auto &h : stats.heap)
+        {
+            heap_bytes += h.heap_bytes;
+        }
+        inline_actions += stats.inline_actions;
+        ns += stats.ns;
+    }
+};
+
+//Owners u.aa, u.ab and so on, each with both tokens in the vault
+static std::vector<name> open_owners(uint32_t count)
+{
+    std::vector<name> owners;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        owners.push_back(name(std::string("u.") + char('a' + i / 26 % 26) + char('a' + i % 26)));
+    }
+    auto token1 = extended_symbol(eos.sym, eos.contract);
+    auto token2 = extended_symbol(usdt.sym, usdt.contract);
+    for (const auto &owner : owners)
+    {
+        run("vaultopen", self, {owner}, &swap::vault_open, {owner, token1, owner});
+        run("vaultopen", self, {owner}, &swap::vault_open, {owner, token2, owner});
+        swap_in(owner, eos, asset(1000000, eos.sym), "vault:" + owner.to_string());
+        swap_in(owner, usdt, asset(4000000, usdt.sym), "vault:" + owner.to_string());
+    }
+    return owners;
+}
+
+//Even owners sell token1, odd owners token2, in amounts that roughly net out at the pool price
+static extended_asset trade_of(uint32_t i)
+{
+    return i % 2 == 0 ? extended_asset(10000 + i * 10, extended_symbol(eos.sym, eos.contract))
+                      : extended_asset(40000 + i * 40, extended_symbol(usdt.sym, usdt.contract));
+}
+
+static test_pool setup_liquidity()
+{
+    auto pool = setup_chain();
+    run("open", self, {alice}, &swap::open, {alice, pool.lq_symbol, alice});
+    deposit(alice, pool.id, asset(100000000, eos.sym), asset(400000000, usdt.sym));
+    return pool;
+}
+
+static int failures = 0;
+
+static void expect(bool pred, const char *msg)
+{
+    if (!pred)
+    {
+        std::fprintf(stderr, "FAIL %s\n", msg);
+        ++failures;
+    }
+}
+
+static int64_t vault_amount(const name &owner, const token &t)
+{
+    vaults rows(self, owner.value);
+    auto index = rows.get_index<name("bytoken")>();
+    auto it = index.find(to_token_key(extended_symbol(t.sym, t.contract)));
+    return it == index.end() ? -1 : it->balance.quantity.amount;
+}
+
+//Settles one batch with a buyer, a seller, an intent below the clearing price and an owner who tries to close
+//the row an intent pays into, and checks the batch record against the vault balances it paid
+static void check_settlement()
+{
+    auto pool = setup_liquidity();
+    auto owners = open_owners(3);
+    const name stuck("u.stuck");
+    auto token1 = extended_symbol(eos.sym, eos.contract);
+    auto token2 = extended_symbol(usdt.sym, usdt.contract);
+    run("vaultopen", self, {stuck}, &swap::vault_open, {stuck, token1, stuck});
+    run("vaultopen", self, {stuck}, &swap::vault_open, {stuck, token2, stuck});
+    swap_in(stuck, usdt, asset(4000000, usdt.sym), "vault:" + stuck.to_string());
+
+    //The empty EOS row is where the USDT intent pays out, so it stays open until the intent is gone
+    run("swapintent", self, {stuck}, &swap::swap_intent, {stuck, pool.id, extended_asset(40000, token2), uint64_t(1)});
+    expect_fail("vaultclose", "intents are pending", self, {stuck}, &swap::vault_close, {stuck, token1});
+
+    std::vector<std::pair<name, extended_asset>> queued = {{owners[0], extended_asset(10000, token1)},
+                                                           {owners[1], extended_asset(40040, token2)},
+                                                           {owners[2], extended_asset(10020, token1)}};
+    std::vector<uint64_t> mins = {1, 1, 1000000};
+    for (size_t i = 0; i < queued.size(); ++i)
+    {
+        run("swapintent", self, {queued[i].first}, &swap::swap_intent, {queued[i].first, pool.id, queued[i].second, mins[i]});
+    }
+    queued.insert(queued.begin(), {stuck, extended_asset(40000, token2)});
+    mins.insert(mins.begin(), 1);
+
+    std::vector<std::pair<int64_t, int64_t>> before;
+    for (const auto &[owner, token_in] : queued)
+    {
+        before.emplace_back(vault_amount(owner, eos), vault_amount(owner, usdt));
+    }
+
+    auto sent = call(self, name(), {bob}, &swap::settle, std::tuple<name, uint64_t, uint32_t>(bob, pool.id, 1));
+    expect(vault_amount(stuck, eos) > 0, "settle skipped the intent at the head of the queue");
+    sent = call(self, name(), {bob}, &swap::settle, std::tuple<name, uint64_t, uint32_t>(bob, pool.id, 3));
+    instr.paused = true;
+    auto details = std::find_if(sent.begin(), sent.end(), [](const auto &act) { return act.name == name("batchdetails"); });
+    expect(details != sent.end(), "settle sent no batchdetails");
+    if (details == sent.end())
+    {
+        return;
+    }
+    auto [pool_id, price, side1, side2, fills] = unpack<std::tuple<uint64_t, double, batch_side, batch_side, std::vector<batch_fill>>>(details->data);
+    expect(pool_id == pool.id && fills.size() == 3, "batch record names the wrong pool or intents");
+
+    int64_t side1_out = 0;
+    int64_t side2_out = 0;
+    for (const auto &fill : fills)
+    {
+        size_t i = 1;
+        while (i < queued.size() && queued[i].first != fill.owner)
+        {
+            ++i;
+        }
+        expect(i < queued.size(), "batch record names an unknown owner");
+        if (i == queued.size())
+        {
+            continue;
+        }
+        auto is_token1 = queued[i].second.get_extended_symbol() == token1;
+        auto paid_in = before[i].first - vault_amount(fill.owner, eos);
+        auto paid_out = vault_amount(fill.owner, usdt) - before[i].second;
+        if (!is_token1)
+        {
+            std::swap(paid_in, paid_out);
+            paid_in = -paid_in;
+            paid_out = -paid_out;
+        }
+
+        if (mins[i] > 1)
+        {
+            //Below its min at the clearing price, the intent's input goes back to the row it came from
+            expect(fill.token_out.amount == 0 && paid_in == -queued[i].second.quantity.amount && paid_out == 0, "intent below its min is not refunded");
+            continue;
+        }
+        auto amount_in = queued[i].second.quantity.amount;
+        auto net = amount_in - (int64_t)((double)(pool_fee_amount + platform_fee_amount) / 10000 * amount_in);
+        auto amount_out = (int64_t)(is_token1 ? (double)net * price : (double)net / price);
+        expect(fill.token_out.amount == amount_out && paid_out == amount_out && paid_in == 0, "payout does not match the clearing price");
+        expect((uint64_t)amount_out >= mins[i], "payout below the intent min");
+        (is_token1 ? side1_out : side2_out) += amount_out;
+    }
+    expect(side1.token_out.quantity.amount == side1_out && side2.token_out.quantity.amount == side2_out, "batch sides do not add up to the fills");
+
+    //Cancelling releases the rows too, so once the payout is withdrawn the row closes
+    run("swapintent", self, {stuck}, &swap::swap_intent, {stuck, pool.id, extended_asset(40000, token2), uint64_t(1)});
+    run("cancelintent", self, {stuck}, &swap::cancel_intent, {stuck, pool.id, uint64_t(4)});
+    open_token_account(eos, stuck);
+    run("vaultwdraw", self, {stuck}, &swap::vault_withdraw, {stuck, extended_asset(vault_amount(stuck, eos), token1)});
+    run("vaultclose", self, {stuck}, &swap::vault_close, {stuck, token1});
+}
+
+static bench_totals run_batch(uint32_t count)
+{
+    auto pool = setup_liquidity();
+    auto owners = open_owners(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        run("swapintent", self, {owners[i]}, &swap::swap_intent, {owners[i], pool.id, trade_of(i), uint64_t(1)});
+    }
+
+    bench_totals totals;
+    auto stats = run("settle", self, {bob}, &swap::settle, {bob, pool.id, count});
+    expect_sent("settle", stats, name("batchdetails"));
+    totals.add(stats);
+    return totals;
+}
+
+static bench_totals run_single(uint32_t count)
+{
+    auto pool = setup_liquidity();
+    auto owners = open_owners(count);
+    bench_totals totals;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        totals.add(run("swapexact", self, {owners[i]}, &swap::swap_exact, {owners[i], trade_of(i), {pool.id}, uint64_t(1)}));
+    }
+    return totals;
+}
+
+int main(int argc, char **argv)
+{
+    instr.paused = true;
+    check_settlement();
+    if (failures > 0)
+    {
+        std::fprintf(stderr, "%d failures\n", failures);
+        return 1;
+    }
+
+    std::vector<uint32_t> counts = {1, 2, 8, 32, 64};
+    if (argc > 1)
+    {
+        counts = {uint32_t(std::stoul(argv[1]))};
+    }
+
+    //Per trade: db calls (reads include secondary index calls), inline actions, heap bytes and native time
+    std::printf("%8s %-10s %8s %8s %8s %10s %10s\n", "intents", "mode", "reads", "writes", "inline", "heap", "ns");
+    for (auto count : counts)
+    {
+        for (const auto &[mode, totals] : {std::make_pair("settle", run_batch(count)), std::make_pair("swapexact", run_single(count))})
+        {
+            std::printf("%8u %-10s %8.1f %8.1f %8.2f %10.0f %10.0f\n", count, mode, double(totals.reads) / count, double(totals.writes) / count,
+                        double(totals.inline_actions) / count, double(totals.heap_bytes) / count, totals.ns / count);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,227 @@
+#pragma once
+#include <algorithm>
+#include <tuple>
+#include <unordered_map>
+#include "trace.hpp"
+
+struct candle_key
+{
+    uint64_t pool_id;
+    uint32_t open_time;
+
+    bool operator==(const candle_key &other) const
+    {
+        return pool_id == other.pool_id && open_time == other.open_time;
+    }
+};
+
+//Prices are quoted per base token, the one of the pair with the lower (contract, symbol), so all
+//swaps of a pool land on one price axis whatever their direction
+struct candle
+{
+    uint64_t base_symbol = 0;
+    uint64_t quote_symbol = 0;
+    double open = 0;
+    double high = 0;
+    double low = 0;
+    double close = 0;
+    int64_t base_volume = 0;
+    int64_t quote_volume = 0;
+    uint32_t trades = 0;
+};
+
+struct fee_key
+{
+    uint64_t pool_id;
+    uint64_t contract;
+    uint64_t symbol;
+
+    bool operator==(const fee_key &other) const
+    {
+        return pool_id == other.pool_id && contract == other.contract && symbol == other.symbol;
+    }
+};
+
+struct fee_total
+{
+    int64_t pool_fee = 0;
+    int64_t platform_fee = 0;
+};
+
+struct position_key
+{
+    uint64_t pool_id;
+    uint64_t owner;
+
+    bool operator==(const position_key &other) const
+    {
+        return pool_id == other.pool_id && owner == other.owner;
+    }
+};
+
+//Net amounts of one LP in one pool, deposits count positive and withdrawals negative
+struct position
+{
+    uint64_t lq_symbol = 0;
+    int64_t lq_amount = 0;
+    uint64_t token1_symbol = 0;
+    int64_t token1_amount = 0;
+    uint64_t token2_symbol = 0;
+    int64_t token2_amount = 0;
+    uint32_t deposits = 0;
+    uint32_t withdrawals = 0;
+    uint32_t last_time = 0;
+};
+
+struct notify_key
+{
+    std::string action_type;
+    uint64_t symbol;
+
+    bool operator==(const notify_key &other) const
+    {
+        return action_type == other.action_type && symbol == other.symbol;
+    }
+};
+
+struct notify_total
+{
+    uint64_t count = 0;
+    int64_t amount = 0;
+};
+
+struct key_hash
+{
+    static size_t mix(uint64_t a, uint64_t b)
+    {
+        return std::hash<uint64_t>()(a * 0x9e3779b97f4a7c15ull ^ b);
+    }
+
+    size_t operator()(const candle_key &key) const
+    {
+        return mix(key.pool_id, key.open_time);
+    }
+    size_t operator()(const fee_key &key) const
+    {
+        return mix(mix(key.pool_id, key.contract), key.symbol);
+    }
+    size_t operator()(const position_key &key) const
+    {
+        return mix(key.pool_id, key.owner);
+    }
+    size_t operator()(const notify_key &key) const
+    {
+        return mix(std::hash<std::string>()(key.action_type), key.symbol);
+    }
+};
+
+//Aggregates of one shard. Records of a pool always go to the same shard, in trace order.
+struct shard_state
+{
+    uint32_t candle_interval;
+    std::unordered_map<candle_key, candle, key_hash> candles;
+    std::unordered_map<fee_key, fee_total, key_hash> fees;
+    std::unordered_map<position_key, position, key_hash> positions;
+    std::unordered_map<notify_key, notify_total, key_hash> notifies;
+    uint64_t actions = 0;
+
+    explicit shard_state(uint32_t candle_interval) : candle_interval(candle_interval) {}
+
+    void process(const record_header &header, const char *data)
+    {
+        if (header.action == swap_details_action)
+        {
+            add_swap(header.block_time, decode_swap_details(data, header.size));
+        }
+        else if (header.action == batch_details_action)
+        {
+            add_batch(header.block_time, decode_batch_details(data, header.size));
+        }
+        else if (header.action == add_lq_details_action)
+        {
+            add_lq(header.block_time, decode_lq_details(data, header.size), 1);
+        }
+        else if (header.action == rmv_lq_details_action)
+        {
+            add_lq(header.block_time, decode_lq_details(data, header.size), -1);
+        }
+        else if (header.action == notify_action)
+        {
+            add_notify(decode_notify(data, header.size));
+        }
+        else
+        {
+            return;
+        }
+        ++actions;
+    }
+
+    void add_swap(uint32_t block_time, const swap_details &details)
+    {
+        const auto &in = details.token_in;
+        const auto &out = details.token_out;
+        auto is_base_in = std::make_tuple(in.contract, in.quantity.symbol) < std::make_tuple(out.contract, out.quantity.symbol);
+        const auto &base = is_base_in ? in : out;
+        const auto &quote = is_base_in ? out : in;
+        //The contract reports output per input
+        auto price = is_base_in ? details.price : details.price > 0 ? 1 / details.price : 0;
+
+        auto &c = candles[candle_key{details.pool_id, block_time - block_time % candle_interval}];
+        if (c.trades == 0)
+        {
+            c.base_symbol = base.quantity.symbol;
+            c.quote_symbol = quote.quantity.symbol;
+            c.open = c.high = c.low = price;
+        }
+        c.high = std::max(c.high, price);
+        c.low = std::min(c.low, price);
+        c.close = price;
+        c.base_volume += base.quantity.amount;
+        c.quote_volume += quote.quantity.amount;
+        ++c.trades;
+
+        auto &pool_fee = fees[fee_key{details.pool_id, details.pool_fee.contract, details.pool_fee.quantity.symbol}];
+        pool_fee.pool_fee += details.pool_fee.quantity.amount;
+        auto &platform_fee = fees[fee_key{details.pool_id, details.platform_fee.contract, details.platform_fee.quantity.symbol}];
+        platform_fee.platform_fee += details.platform_fee.quantity.amount;
+    }
+
+    //A settle trades both sides at one price, so each side with volume counts as one trade of the candle
+    void add_batch(uint32_t block_time, const batch_details &details)
+    {
+        for (const auto &[side, price] : {std::make_pair(details.side1, details.price), std::make_pair(details.side2, details.price > 0 ? 1 / details.price : 0)})
+        {
+            if (side.token_in.quantity.amount > 0)
+            {
+                add_swap(block_time, swap_details{details.pool_id, 0, side.token_in, side.token_out, side.pool_fee, side.platform_fee, price});
+            }
+        }
+    }
+
+    void add_lq(uint32_t block_time, const lq_details &details, int64_t sign)
+    {
+        auto &p = positions[position_key{details.pool_id, details.owner}];
+        p.lq_symbol = details.lqtoken.symbol;
+        p.lq_amount += sign * details.lqtoken.amount;
+        p.token1_symbol = details.token1.quantity.symbol;
+        p.token1_amount += sign * details.token1.quantity.amount;
+        p.token2_symbol = details.token2.quantity.symbol;
+        p.token2_amount += sign * details.token2.quantity.amount;
+        if (sign > 0)
+        {
+            ++p.deposits;
+        }
+        else
+        {
+            ++p.withdrawals;
+        }
+        p.last_time = block_time;
+    }
+
+    void add_notify(const notify_details &details)
+    {
+        auto &n = notifies[notify_key{std::string(details.action_type), details.quantity.symbol}];
+        ++n.count;
+        n.amount += details.quantity.amount;
+    }
+};
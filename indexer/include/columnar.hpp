@@ -0,0 +1,100 @@
+#pragma once
+#include <fstream>
+#include <string>
+#include <vector>
+#include "trace.hpp"
+
+enum class column_type : uint8_t
+{
+    u32 = 1,
+    u64 = 2,
+    i64 = 3,
+    f64 = 4,
+    str = 5
+};
+
+template <typename T>
+constexpr column_type column_type_of();
+template <>
+constexpr column_type column_type_of<uint32_t>() { return column_type::u32; }
+template <>
+constexpr column_type column_type_of<uint64_t>() { return column_type::u64; }
+template <>
+constexpr column_type column_type_of<int64_t>() { return column_type::i64; }
+template <>
+constexpr column_type column_type_of<double>() { return column_type::f64; }
+
+//Column file: magic, row count, column count, then per column its type and name, then the columns one
+//after another. Fixed-width columns are plain little endian arrays. A string column is a uint32 offset
+//array of rows + 1 entries followed by the concatenated bytes.
+class column_writer
+{
+public:
+    explicit column_writer(uint64_t rows) : rows(rows) {}
+
+    template <typename T>
+    void add(const std::string &name, const std::vector<T> &values)
+    {
+        check(values.size() == rows, "column_writer : column size mismatch");
+        std::vector<char> data;
+        data.reserve(values.size() * sizeof(T));
+        for (const auto &value : values)
+        {
+            append(data, value);
+        }
+        columns.push_back(column{column_type_of<T>(), name, std::move(data)});
+    }
+
+    void add(const std::string &name, const std::vector<std::string> &values)
+    {
+        check(values.size() == rows, "column_writer : column size mismatch");
+        std::vector<char> data;
+        uint32_t offset = 0;
+        append(data, offset);
+        for (const auto &value : values)
+        {
+            offset += uint32_t(value.size());
+            append(data, offset);
+        }
+        for (const auto &value : values)
+        {
+            data.insert(data.end(), value.begin(), value.end());
+        }
+        columns.push_back(column{column_type::str, name, std::move(data)});
+    }
+
+    void write(const std::string &path) const
+    {
+        std::vector<char> out;
+        out.insert(out.end(), column_magic, column_magic + sizeof(column_magic));
+        append(out, rows);
+        append(out, uint32_t(columns.size()));
+        for (const auto &col : columns)
+        {
+            append(out, uint8_t(col.type));
+            append(out, std::string_view(col.name));
+        }
+        for (const auto &col : columns)
+        {
+            out.insert(out.end(), col.data.begin(), col.data.end());
+        }
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        check(file.good(), "column_writer : can not open output file");
+        file.write(out.data(), out.size());
+        check(file.good(), "column_writer : write failed");
+    }
+
+private:
+    static constexpr char column_magic[8] = {'S', 'P', 'C', 'O', 'L', '1', 0, 0};
+
+    struct column
+    {
+        column_type type;
+        std::string name;
+        std::vector<char> data;
+    };
+
+    uint64_t rows;
+    std::vector<column> columns;
+};
@@ -0,0 +1,72 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include "aggregate.hpp"
+
+struct indexer_options
+{
+    uint32_t threads = 1;
+    uint32_t candle_interval = 3600;
+    uint64_t account = 0; //0 takes actions of any account
+    size_t chunk_bytes = 4 << 20;
+};
+
+struct indexer_stats
+{
+    uint64_t bytes = 0;
+    uint64_t records = 0;
+    uint64_t actions = 0;
+};
+
+//Records of one read block, with the offsets of the records each shard has to process
+struct trace_chunk
+{
+    std::vector<char> data;
+    std::vector<std::vector<uint32_t>> shards;
+};
+
+//Every consumer sees every chunk in order, a chunk is dropped once all consumers are past it
+class chunk_queue
+{
+public:
+    chunk_queue(size_t consumers, size_t capacity);
+
+    void push(std::shared_ptr<const trace_chunk> chunk);
+    void close();
+    std::shared_ptr<const trace_chunk> pop(size_t consumer);
+
+private:
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::shared_ptr<const trace_chunk>> chunks;
+    std::vector<uint64_t> next;
+    uint64_t first = 0;
+    size_t capacity;
+    bool closed = false;
+};
+
+//Streams a trace file, decodes the swap.pcash detail actions from their binary payloads and
+//aggregates them on one thread per shard. Records are sharded by pool_id.
+class trace_indexer
+{
+public:
+    explicit trace_indexer(const indexer_options &options);
+
+    indexer_stats run(std::istream &in);
+    void write(const std::string &dir) const;
+
+    const std::vector<shard_state> &get_shards() const
+    {
+        return shards;
+    }
+
+private:
+    std::shared_ptr<trace_chunk> read_chunk(std::istream &in, std::vector<char> &rest, indexer_stats &stats) const;
+    void run_shard(size_t index, chunk_queue &queue, std::exception_ptr &error);
+
+    indexer_options options;
+    std::vector<shard_state> shards;
+};
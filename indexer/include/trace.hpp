@@ -0,0 +1,373 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//Trace file record: a fixed header followed by the raw action data as it appears in the action trace.
+//All integers are little endian, the same as the action data itself.
+//Accounts can opt out of swapdetails, lq details and notify, so a trace covers every trade only while the
+//contract's own setntfpolicy row forces them on; batchdetails is always sent.
+struct record_header
+{
+    uint64_t account;
+    uint64_t action;
+    uint32_t block_time;
+    uint32_t size;
+};
+static_assert(sizeof(record_header) == 24, "record header must be packed");
+
+struct asset
+{
+    int64_t amount = 0;
+    uint64_t symbol = 0;
+};
+
+struct extended_asset
+{
+    asset quantity;
+    uint64_t contract = 0;
+};
+
+struct swap_details
+{
+    uint64_t pool_id;
+    uint64_t owner;
+    extended_asset token_in;
+    extended_asset token_out;
+    extended_asset pool_fee;
+    extended_asset platform_fee;
+    double price;
+};
+
+struct lq_details
+{
+    uint64_t pool_id;
+    uint64_t owner;
+    asset lqtoken;
+    extended_asset token1;
+    extended_asset token2;
+};
+
+struct batch_side
+{
+    extended_asset token_in;
+    extended_asset token_out;
+    extended_asset pool_fee;
+    extended_asset platform_fee;
+};
+
+struct batch_fill
+{
+    uint64_t intent_id;
+    uint64_t owner;
+    asset token_in;
+    asset token_out;
+};
+
+//One settle: the clearing price, the totals of each side and the fill of each intent
+struct batch_details
+{
+    uint64_t pool_id;
+    double price;
+    batch_side side1;
+    batch_side side2;
+    std::vector<batch_fill> fills;
+};
+
+struct notify_details
+{
+    std::string_view action_type;
+    uint64_t to;
+    uint64_t from;
+    asset quantity;
+    std::string_view memo;
+};
+
+constexpr size_t swap_details_size = 120;
+constexpr size_t lq_details_size = 80;
+constexpr size_t batch_details_fixed_size = 208;
+constexpr size_t batch_fill_size = 48;
+
+inline void check(bool pred, const char *msg)
+{
+    if (!pred)
+    {
+        throw std::runtime_error(msg);
+    }
+}
+
+//Same encoding as eosio::name
+constexpr uint64_t to_name(std::string_view str)
+{
+    uint64_t value = 0;
+    for (size_t i = 0; i < str.size() && i < 13; ++i)
+    {
+        auto c = str[i];
+        uint64_t code = c == '.' ? 0 : c >= '1' && c <= '5' ? c - '1' + 1 : c >= 'a' && c <= 'z' ? c - 'a' + 6 : 0;
+        if (i < 12)
+        {
+            value |= (code & 0x1f) << (64 - 5 * (i + 1));
+        }
+        else
+        {
+            value |= code & 0x0f;
+        }
+    }
+    return value;
+}
+
+inline std::string from_name(uint64_t value)
+{
+    static const char *charmap = ".12345abcdefghijklmnopqrstuvwxyz";
+    std::string str(13, '.');
+    auto tmp = value;
+    for (int i = 0; i <= 12; ++i)
+    {
+        auto c = charmap[tmp & (i == 0 ? 0x0f : 0x1f)];
+        str[12 - i] = c;
+        tmp >>= (i == 0 ? 4 : 5);
+    }
+    str.erase(str.find_last_not_of('.') + 1);
+    return str;
+}
+
+const uint64_t swap_details_action = to_name("swapdetails");
+const uint64_t add_lq_details_action = to_name("addlqdetails");
+const uint64_t rmv_lq_details_action = to_name("rmvlqdetails");
+const uint64_t batch_details_action = to_name("batchdetails");
+const uint64_t notify_action = to_name("notify");
+
+class payload_reader
+{
+public:
+    payload_reader(const char *data, size_t size) : pos(data), end(data + size) {}
+
+    template <typename T>
+    T read()
+    {
+        check(size_t(end - pos) >= sizeof(T), "payload_reader : payload is too short");
+        T value;
+        std::memcpy(&value, pos, sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
+
+    uint32_t read_varuint32()
+    {
+        uint32_t value = 0;
+        for (int shift = 0; shift < 35; shift += 7)
+        {
+            auto byte = read<uint8_t>();
+            value |= uint32_t(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+            {
+                return value;
+            }
+        }
+        throw std::runtime_error("payload_reader : varuint32 is too long");
+    }
+
+    std::string_view read_string()
+    {
+        auto size = read_varuint32();
+        check(size_t(end - pos) >= size, "payload_reader : string is too long");
+        std::string_view str(pos, size);
+        pos += size;
+        return str;
+    }
+
+    asset read_asset()
+    {
+        asset value;
+        value.amount = read<int64_t>();
+        value.symbol = read<uint64_t>();
+        return value;
+    }
+
+    extended_asset read_extended_asset()
+    {
+        extended_asset value;
+        value.quantity = read_asset();
+        value.contract = read<uint64_t>();
+        return value;
+    }
+
+    size_t remaining() const
+    {
+        return size_t(end - pos);
+    }
+
+private:
+    const char *pos;
+    const char *end;
+};
+
+inline swap_details decode_swap_details(const char *data, size_t size)
+{
+    check(size == swap_details_size, "decode_swap_details : invalid payload size");
+    payload_reader reader(data, size);
+    swap_details details;
+    details.pool_id = reader.read<uint64_t>();
+    details.owner = reader.read<uint64_t>();
+    details.token_in = reader.read_extended_asset();
+    details.token_out = reader.read_extended_asset();
+    details.pool_fee = reader.read_extended_asset();
+    details.platform_fee = reader.read_extended_asset();
+    details.price = reader.read<double>();
+    return details;
+}
+
+inline lq_details decode_lq_details(const char *data, size_t size)
+{
+    check(size == lq_details_size, "decode_lq_details : invalid payload size");
+    payload_reader reader(data, size);
+    lq_details details;
+    details.pool_id = reader.read<uint64_t>();
+    details.owner = reader.read<uint64_t>();
+    details.lqtoken = reader.read_asset();
+    details.token1 = reader.read_extended_asset();
+    details.token2 = reader.read_extended_asset();
+    return details;
+}
+
+inline batch_side read_batch_side(payload_reader &reader)
+{
+    batch_side side;
+    side.token_in = reader.read_extended_asset();
+    side.token_out = reader.read_extended_asset();
+    side.pool_fee = reader.read_extended_asset();
+    side.platform_fee = reader.read_extended_asset();
+    return side;
+}
+
+inline batch_details decode_batch_details(const char *data, size_t size)
+{
+    check(size > batch_details_fixed_size, "decode_batch_details : invalid payload size");
+    payload_reader reader(data, size);
+    batch_details details;
+    details.pool_id = reader.read<uint64_t>();
+    details.price = reader.read<double>();
+    details.side1 = read_batch_side(reader);
+    details.side2 = read_batch_side(reader);
+    auto count = reader.read_varuint32();
+    check(reader.remaining() == size_t(count) * batch_fill_size, "decode_batch_details : invalid fill count");
+    details.fills.resize(count);
+    for (auto &fill : details.fills)
+    {
+        fill.intent_id = reader.read<uint64_t>();
+        fill.owner = reader.read<uint64_t>();
+        fill.token_in = reader.read_asset();
+        fill.token_out = reader.read_asset();
+    }
+    return details;
+}
+
+inline notify_details decode_notify(const char *data, size_t size)
+{
+    payload_reader reader(data, size);
+    notify_details details;
+    details.action_type = reader.read_string();
+    details.to = reader.read<uint64_t>();
+    details.from = reader.read<uint64_t>();
+    details.quantity = reader.read_asset();
+    details.memo = reader.read_string();
+    return details;
+}
+
+template <typename T>
+void append(std::vector<char> &out, const T &value)
+{
+    auto pos = out.size();
+    out.resize(pos + sizeof(T));
+    std::memcpy(out.data() + pos, &value, sizeof(T));
+}
+
+inline void append(std::vector<char> &out, const asset &value)
+{
+    append(out, value.amount);
+    append(out, value.symbol);
+}
+
+inline void append(std::vector<char> &out, const extended_asset &value)
+{
+    append(out, value.quantity);
+    append(out, value.contract);
+}
+
+inline void append_varuint32(std::vector<char> &out, uint32_t value)
+{
+    do
+    {
+        uint8_t byte = value & 0x7f;
+        value >>= 7;
+        append(out, uint8_t(byte | (value ? 0x80 : 0)));
+    } while (value);
+}
+
+inline void append(std::vector<char> &out, const std::string_view &str)
+{
+    append_varuint32(out, uint32_t(str.size()));
+    out.insert(out.end(), str.begin(), str.end());
+}
+
+//Appends a whole record, header included, as the contract would have emitted it
+inline void append_swap_details(std::vector<char> &out, uint64_t account, uint32_t block_time, const swap_details &details)
+{
+    append(out, record_header{account, swap_details_action, block_time, uint32_t(swap_details_size)});
+    append(out, details.pool_id);
+    append(out, details.owner);
+    append(out, details.token_in);
+    append(out, details.token_out);
+    append(out, details.pool_fee);
+    append(out, details.platform_fee);
+    append(out, details.price);
+}
+
+inline void append_lq_details(std::vector<char> &out, uint64_t account, uint64_t action, uint32_t block_time, const lq_details &details)
+{
+    append(out, record_header{account, action, block_time, uint32_t(lq_details_size)});
+    append(out, details.pool_id);
+    append(out, details.owner);
+    append(out, details.lqtoken);
+    append(out, details.token1);
+    append(out, details.token2);
+}
+
+inline void append_batch_details(std::vector<char> &out, uint64_t account, uint32_t block_time, const batch_details &details)
+{
+    std::vector<char> payload;
+    append(payload, details.pool_id);
+    append(payload, details.price);
+    for (const auto &side : {details.side1, details.side2})
+    {
+        append(payload, side.token_in);
+        append(payload, side.token_out);
+        append(payload, side.pool_fee);
+        append(payload, side.platform_fee);
+    }
+    append_varuint32(payload, uint32_t(details.fills.size()));
+    for (const auto &fill : details.fills)
+    {
+        append(payload, fill.intent_id);
+        append(payload, fill.owner);
+        append(payload, fill.token_in);
+        append(payload, fill.token_out);
+    }
+    append(out, record_header{account, batch_details_action, block_time, uint32_t(payload.size())});
+    out.insert(out.end(), payload.begin(), payload.end());
+}
+
+inline void append_notify(std::vector<char> &out, uint64_t account, uint32_t block_time, const notify_details &details)
+{
+    std::vector<char> payload;
+    append(payload, details.action_type);
+    append(payload, details.to);
+    append(payload, details.from);
+    append(payload, details.quantity);
+    append(payload, details.memo);
+    append(out, record_header{account, notify_action, block_time, uint32_t(payload.size())});
+    out.insert(out.end(), payload.begin(), payload.end());
+}
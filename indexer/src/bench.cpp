@@ -0,0 +1,148 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <thread>
+#include "indexer.hpp"
+
+struct bench_options
+{
+    uint64_t actions = 2000000;
+    uint64_t pools = 256;
+    uint32_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::string file = "trace_bench.bin";
+};
+
+//Synthetic trace with the action mix of a busy period: mostly swaps, some liquidity changes, settles and notifies
+static void write_trace(const bench_options &options)
+{
+    const auto account = to_name("swap.pcash");
+    const auto token_contract = to_name("eosio.token");
+    std::mt19937_64 rng(42);
+    std::ofstream out(options.file, std::ios::binary | std::ios::trunc);
+    check(out.good(), "write_trace : can not open trace file");
+
+    std::vector<char> buffer;
+    uint32_t block_time = 1600000000;
+    for (uint64_t i = 0; i < options.actions; ++i)
+    {
+        auto pool_id = rng() % options.pools;
+        auto owner = to_name("user") + rng() % 4096;
+        extended_asset token1{{0, (pool_id << 8) | 4}, token_contract};
+        extended_asset token2{{0, ((pool_id + options.pools) << 8) | 4}, token_contract};
+        block_time += rng() % 2;
+
+        auto kind = rng() % 100;
+        if (kind < 90)
+        {
+            swap_details details;
+            auto is_token1_in = rng() % 2 == 0;
+            details.pool_id = pool_id;
+            details.owner = owner;
+            details.token_in = is_token1_in ? token1 : token2;
+            details.token_out = is_token1_in ? token2 : token1;
+            details.token_in.quantity.amount = 10000 + rng() % 1000000;
+            details.price = is_token1_in ? 2.0 + (rng() % 100) / 1000.0 : 0.5 - (rng() % 100) / 10000.0;
+            details.token_out.quantity.amount = int64_t(details.token_in.quantity.amount * details.price);
+            details.pool_fee = details.token_in;
+            details.pool_fee.quantity.amount /= 500;
+            details.platform_fee = details.token_in;
+            details.platform_fee.quantity.amount /= 2000;
+            append_swap_details(buffer, account, block_time, details);
+        }
+        else if (kind < 98)
+        {
+            lq_details details;
+            details.pool_id = pool_id;
+            details.owner = owner;
+            details.lqtoken = asset{int64_t(1000 + rng() % 100000), (pool_id << 8) | 4};
+            details.token1 = token1;
+            details.token1.quantity.amount = details.lqtoken.amount * 2;
+            details.token2 = token2;
+            details.token2.quantity.amount = details.lqtoken.amount;
+            append_lq_details(buffer, account, kind < 94 ? add_lq_details_action : rmv_lq_details_action, block_time, details);
+        }
+        else if (kind < 99)
+        {
+            batch_details details{pool_id, 2.0 + (rng() % 100) / 1000.0, {token1, token2, token1, token1}, {token2, token1, token2, token2}, {}};
+            details.fills.resize(1 + rng() % 16);
+            for (auto &fill : details.fills)
+            {
+                auto is_token1_in = rng() % 2 == 0;
+                auto &side = is_token1_in ? details.side1 : details.side2;
+                auto price = is_token1_in ? details.price : 1 / details.price;
+                fill = batch_fill{i, to_name("user") + rng() % 4096, side.token_in.quantity, side.token_out.quantity};
+                fill.token_in.amount = 10000 + rng() % 1000000;
+                fill.token_out.amount = int64_t(fill.token_in.amount * price);
+                side.token_in.quantity.amount += fill.token_in.amount;
+                side.token_out.quantity.amount += fill.token_out.amount;
+                side.pool_fee.quantity.amount += fill.token_in.amount / 500;
+                side.platform_fee.quantity.amount += fill.token_in.amount / 2000;
+            }
+            append_batch_details(buffer, account, block_time, details);
+        }
+        else
+        {
+            notify_details details{"swap", owner, account, token1.quantity, "swap.pcash: swap"};
+            details.quantity.amount = 10000 + rng() % 1000000;
+            append_notify(buffer, account, block_time, details);
+        }
+
+        if (buffer.size() >= (1 << 20))
+        {
+            out.write(buffer.data(), buffer.size());
+            buffer.clear();
+        }
+    }
+    out.write(buffer.data(), buffer.size());
+    check(out.good(), "write_trace : write failed");
+}
+
+int main(int argc, char **argv)
+{
+    bench_options options;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string arg = argv[i];
+        std::string value = argv[i + 1];
+        if (arg == "-n")
+            options.actions = std::stoull(value);
+        else if (arg == "-p")
+            options.pools = std::stoull(value);
+        else if (arg == "-t")
+            options.max_threads = std::stoul(value);
+        else if (arg == "-f")
+            options.file = value;
+    }
+
+    try
+    {
+        //The trace is rewritten on every run, a file left by a run with other options would skew the numbers
+        std::printf("writing %llu synthetic actions over %llu pools to %s\n", (unsigned long long)options.actions,
+                    (unsigned long long)options.pools, options.file.c_str());
+        write_trace(options);
+
+        std::printf("%8s %12s %14s %18s\n", "threads", "actions", "actions/s", "actions/s/core");
+        for (uint32_t threads = 1; threads <= options.max_threads; threads *= 2)
+        {
+            indexer_options indexer_opts;
+            indexer_opts.threads = threads;
+            trace_indexer indexer(indexer_opts);
+            std::ifstream in(options.file, std::ios::binary);
+            check(in.good(), "main : can not open trace file");
+
+            auto start = std::chrono::steady_clock::now();
+            auto stats = indexer.run(in);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+            auto rate = stats.actions / elapsed.count();
+            std::printf("%8u %12llu %14.0f %18.0f\n", threads, (unsigned long long)stats.actions, rate, rate / threads);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
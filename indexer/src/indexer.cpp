@@ -0,0 +1,275 @@
+#include <algorithm>
+#include <map>
+#include <thread>
+#include "columnar.hpp"
+#include "indexer.hpp"
+
+chunk_queue::chunk_queue(size_t consumers, size_t capacity) : next(consumers, 0), capacity(capacity) {}
+
+void chunk_queue::push(std::shared_ptr<const trace_chunk> chunk)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [&] { return chunks.size() < capacity; });
+    chunks.push_back(std::move(chunk));
+    changed.notify_all();
+}
+
+void chunk_queue::close()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    closed = true;
+    changed.notify_all();
+}
+
+std::shared_ptr<const trace_chunk> chunk_queue::pop(size_t consumer)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [&] { return next[consumer] < first + chunks.size() || closed; });
+    if (next[consumer] == first + chunks.size())
+    {
+        return nullptr;
+    }
+
+    auto chunk = chunks[next[consumer] - first];
+    ++next[consumer];
+    while (!chunks.empty() && *std::min_element(next.begin(), next.end()) > first)
+    {
+        chunks.pop_front();
+        ++first;
+        changed.notify_all();
+    }
+    return chunk;
+}
+
+trace_indexer::trace_indexer(const indexer_options &options) : options(options)
+{
+    check(options.threads > 0, "trace_indexer : invalid threads");
+    check(options.candle_interval > 0, "trace_indexer : invalid candle interval");
+    shards.reserve(options.threads);
+    for (uint32_t i = 0; i < options.threads; ++i)
+    {
+        shards.emplace_back(options.candle_interval);
+    }
+}
+
+indexer_stats trace_indexer::run(std::istream &in)
+{
+    indexer_stats stats;
+    chunk_queue queue(shards.size(), 4);
+    std::vector<std::exception_ptr> errors(shards.size());
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < shards.size(); ++i)
+    {
+        workers.emplace_back(&trace_indexer::run_shard, this, i, std::ref(queue), std::ref(errors[i]));
+    }
+
+    std::exception_ptr read_error;
+    try
+    {
+        std::vector<char> rest;
+        while (auto chunk = read_chunk(in, rest, stats))
+        {
+            queue.push(std::move(chunk));
+        }
+    }
+    catch (...)
+    {
+        read_error = std::current_exception();
+    }
+    queue.close();
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+
+    if (read_error)
+    {
+        std::rethrow_exception(read_error);
+    }
+    for (const auto &error : errors)
+    {
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+    for (const auto &shard : shards)
+    {
+        stats.actions += shard.actions;
+    }
+    return stats;
+}
+
+std::shared_ptr<trace_chunk> trace_indexer::read_chunk(std::istream &in, std::vector<char> &rest, indexer_stats &stats) const
+{
+    auto chunk = std::make_shared<trace_chunk>();
+    chunk->data.swap(rest);
+    auto kept = chunk->data.size();
+    chunk->data.resize(kept + options.chunk_bytes);
+    in.read(chunk->data.data() + kept, options.chunk_bytes);
+    auto size = kept + size_t(in.gcount());
+    chunk->data.resize(size);
+    stats.bytes += in.gcount();
+    if (size == 0)
+    {
+        return nullptr;
+    }
+
+    chunk->shards.resize(shards.size());
+    size_t pos = 0;
+    while (size - pos >= sizeof(record_header))
+    {
+        record_header header;
+        std::memcpy(&header, chunk->data.data() + pos, sizeof(header));
+        if (size - pos - sizeof(header) < header.size)
+        {
+            break;
+        }
+
+        auto payload = chunk->data.data() + pos + sizeof(header);
+        auto is_known = header.action == swap_details_action || header.action == batch_details_action || header.action == add_lq_details_action ||
+                        header.action == rmv_lq_details_action || header.action == notify_action;
+        if (is_known && (options.account == 0 || header.account == options.account))
+        {
+            //Detail actions start with pool_id, notify has no pool and goes round robin
+            uint64_t key = stats.records;
+            if (header.action != notify_action && header.size >= sizeof(uint64_t))
+            {
+                std::memcpy(&key, payload, sizeof(key));
+            }
+            chunk->shards[key % shards.size()].push_back(uint32_t(pos));
+        }
+        pos += sizeof(header) + header.size;
+        ++stats.records;
+    }
+
+    check(in.gcount() > 0 || pos == size, "read_chunk : trace file ends with a truncated record");
+    rest.assign(chunk->data.begin() + pos, chunk->data.end());
+    chunk->data.resize(pos);
+    return chunk;
+}
+
+void trace_indexer::run_shard(size_t index, chunk_queue &queue, std::exception_ptr &error)
+{
+    auto &shard = shards[index];
+    //After an error the queue is still drained, so the reader never blocks on a full queue
+    while (auto chunk = queue.pop(index))
+    {
+        if (error)
+        {
+            continue;
+        }
+        try
+        {
+            for (auto offset : chunk->shards[index])
+            {
+                record_header header;
+                std::memcpy(&header, chunk->data.data() + offset, sizeof(header));
+                shard.process(header, chunk->data.data() + offset + sizeof(header));
+            }
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+    }
+}
+
+void trace_indexer::write(const std::string &dir) const
+{
+    //A pool lives in exactly one shard, so only the notify totals need merging
+    std::vector<std::pair<candle_key, const candle *>> candles;
+    std::vector<std::pair<fee_key, const fee_total *>> fees;
+    std::vector<std::pair<position_key, const position *>> positions;
+    std::map<std::pair<std::string, uint64_t>, notify_total> notifies;
+    for (const auto &shard : shards)
+    {
+        for (const auto &[key, value] : shard.candles)
+            candles.emplace_back(key, &value);
+        for (const auto &[key, value] : shard.fees)
+            fees.emplace_back(key, &value);
+        for (const auto &[key, value] : shard.positions)
+            positions.emplace_back(key, &value);
+        for (const auto &[key, value] : shard.notifies)
+        {
+            auto &total = notifies[std::make_pair(key.action_type, key.symbol)];
+            total.count += value.count;
+            total.amount += value.amount;
+        }
+    }
+    std::sort(candles.begin(), candles.end(), [](const auto &a, const auto &b) {
+        return std::tie(a.first.pool_id, a.first.open_time) < std::tie(b.first.pool_id, b.first.open_time);
+    });
+    std::sort(fees.begin(), fees.end(), [](const auto &a, const auto &b) {
+        return std::tie(a.first.pool_id, a.first.contract, a.first.symbol) < std::tie(b.first.pool_id, b.first.contract, b.first.symbol);
+    });
+    std::sort(positions.begin(), positions.end(), [](const auto &a, const auto &b) {
+        return std::tie(a.first.pool_id, a.first.owner) < std::tie(b.first.pool_id, b.first.owner);
+    });
+
+    auto column = [](const auto &rows, auto field) {
+        std::vector<std::decay_t<decltype(field(rows.front()))>> values;
+        values.reserve(rows.size());
+        for (const auto &row : rows)
+        {
+            values.push_back(field(row));
+        }
+        return values;
+    };
+
+    if (!candles.empty())
+    {
+        column_writer out(candles.size());
+        out.add("pool_id", column(candles, [](const auto &r) { return r.first.pool_id; }));
+        out.add("open_time", column(candles, [](const auto &r) { return r.first.open_time; }));
+        out.add("base_symbol", column(candles, [](const auto &r) { return r.second->base_symbol; }));
+        out.add("quote_symbol", column(candles, [](const auto &r) { return r.second->quote_symbol; }));
+        out.add("open", column(candles, [](const auto &r) { return r.second->open; }));
+        out.add("high", column(candles, [](const auto &r) { return r.second->high; }));
+        out.add("low", column(candles, [](const auto &r) { return r.second->low; }));
+        out.add("close", column(candles, [](const auto &r) { return r.second->close; }));
+        out.add("base_volume", column(candles, [](const auto &r) { return r.second->base_volume; }));
+        out.add("quote_volume", column(candles, [](const auto &r) { return r.second->quote_volume; }));
+        out.add("trades", column(candles, [](const auto &r) { return r.second->trades; }));
+        out.write(dir + "/candles.col");
+    }
+
+    if (!fees.empty())
+    {
+        column_writer out(fees.size());
+        out.add("pool_id", column(fees, [](const auto &r) { return r.first.pool_id; }));
+        out.add("contract", column(fees, [](const auto &r) { return r.first.contract; }));
+        out.add("symbol", column(fees, [](const auto &r) { return r.first.symbol; }));
+        out.add("pool_fee", column(fees, [](const auto &r) { return r.second->pool_fee; }));
+        out.add("platform_fee", column(fees, [](const auto &r) { return r.second->platform_fee; }));
+        out.write(dir + "/fees.col");
+    }
+
+    if (!positions.empty())
+    {
+        column_writer out(positions.size());
+        out.add("pool_id", column(positions, [](const auto &r) { return r.first.pool_id; }));
+        out.add("owner", column(positions, [](const auto &r) { return r.first.owner; }));
+        out.add("lq_symbol", column(positions, [](const auto &r) { return r.second->lq_symbol; }));
+        out.add("lq_amount", column(positions, [](const auto &r) { return r.second->lq_amount; }));
+        out.add("token1_symbol", column(positions, [](const auto &r) { return r.second->token1_symbol; }));
+        out.add("token1_amount", column(positions, [](const auto &r) { return r.second->token1_amount; }));
+        out.add("token2_symbol", column(positions, [](const auto &r) { return r.second->token2_symbol; }));
+        out.add("token2_amount", column(positions, [](const auto &r) { return r.second->token2_amount; }));
+        out.add("deposits", column(positions, [](const auto &r) { return r.second->deposits; }));
+        out.add("withdrawals", column(positions, [](const auto &r) { return r.second->withdrawals; }));
+        out.add("last_time", column(positions, [](const auto &r) { return r.second->last_time; }));
+        out.write(dir + "/positions.col");
+    }
+
+    if (!notifies.empty())
+    {
+        std::vector<std::pair<std::pair<std::string, uint64_t>, notify_total>> rows(notifies.begin(), notifies.end());
+        column_writer out(rows.size());
+        out.add("action_type", column(rows, [](const auto &r) { return r.first.first; }));
+        out.add("symbol", column(rows, [](const auto &r) { return r.first.second; }));
+        out.add("count", column(rows, [](const auto &r) { return r.second.count; }));
+        out.add("amount", column(rows, [](const auto &r) { return r.second.amount; }));
+        out.write(dir + "/notify.col");
+    }
+}
@@ -0,0 +1,133 @@
+//Indexes a small hand-built trace and checks the candles, fee totals and LP positions it aggregates
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include "indexer.hpp"
+
+static int failures = 0;
+
+static void expect(bool pred, const char *msg)
+{
+    if (!pred)
+    {
+        std::fprintf(stderr, "FAIL %s\n", msg);
+        ++failures;
+    }
+}
+
+static bool near(double a, double b)
+{
+    return std::fabs(a - b) < 1e-9;
+}
+
+const uint64_t account = to_name("swap.pcash");
+const uint64_t token_contract = to_name("eosio.token");
+//Token1 sorts first, so it is the base of pool 1 and token2 the base of pool 2
+const extended_asset token1{{0, (1 << 8) | 4}, token_contract};
+const extended_asset token2{{0, (2 << 8) | 4}, token_contract};
+const extended_asset token3{{0, (3 << 8) | 4}, token_contract};
+const uint32_t hour = 1600000000 - 1600000000 % 3600;
+
+static extended_asset amount(const extended_asset &token, int64_t value)
+{
+    auto result = token;
+    result.quantity.amount = value;
+    return result;
+}
+
+static std::string build_trace()
+{
+    std::vector<char> out;
+    const auto alice = to_name("alice");
+    const auto bob = to_name("bob");
+
+    //A swap each way, the second one quoted as output per input like the contract reports it
+    append_swap_details(out, account, hour + 10, {1, bob, amount(token1, 10000), amount(token2, 20000), amount(token1, 20), amount(token1, 5), 2.0});
+    append_swap_details(out, account, hour + 20, {1, bob, amount(token2, 41000), amount(token1, 20000), amount(token2, 82), amount(token2, 20), 20000.0 / 41000});
+
+    //A settle at 1.9 token2 per token1 with volume on both sides, side2 is quoted at 1 / price
+    batch_details batch{1, 1.9, {amount(token1, 10000), amount(token2, 19000), amount(token1, 20), amount(token1, 5)},
+                        {amount(token2, 38000), amount(token1, 20000), amount(token2, 76), amount(token2, 19)}, {}};
+    batch.fills.push_back({0, alice, amount(token1, 10000).quantity, amount(token2, 19000).quantity});
+    batch.fills.push_back({1, bob, amount(token2, 38000).quantity, amount(token1, 20000).quantity});
+    append_batch_details(out, account, hour + 30, batch);
+
+    //A two hop swapexact from a vault reports one swapdetails per hop
+    append_swap_details(out, account, hour + 40, {1, alice, amount(token1, 5000), amount(token2, 10500), amount(token1, 10), amount(token1, 3), 2.1});
+    append_swap_details(out, account, hour + 40, {2, alice, amount(token2, 10500), amount(token3, 5000), amount(token2, 21), amount(token2, 5), 5000.0 / 10500});
+
+    //The next hour opens a new candle, a record of another account is left out
+    append_swap_details(out, account, hour + 3600, {1, bob, amount(token1, 1000), amount(token2, 2200), amount(token1, 2), amount(token1, 1), 2.2});
+    append_swap_details(out, to_name("other"), hour + 3610, {1, bob, amount(token1, 9000), amount(token2, 90000), amount(token1, 9), amount(token1, 9), 10.0});
+
+    append_lq_details(out, account, add_lq_details_action, hour + 50, {1, alice, {1000, (4 << 8)}, amount(token1, 100), amount(token2, 200)});
+    append_lq_details(out, account, add_lq_details_action, hour + 60, {1, alice, {500, (4 << 8)}, amount(token1, 50), amount(token2, 100)});
+    append_lq_details(out, account, rmv_lq_details_action, hour + 70, {1, alice, {300, (4 << 8)}, amount(token1, 30), amount(token2, 60)});
+    return std::string(out.begin(), out.end());
+}
+
+template <typename Map, typename Key>
+static const typename Map::mapped_type *find_row(const std::vector<shard_state> &shards, Map shard_state::*rows, const Key &key)
+{
+    for (const auto &shard : shards)
+    {
+        auto it = (shard.*rows).find(key);
+        if (it != (shard.*rows).end())
+        {
+            return &it->second;
+        }
+    }
+    return nullptr;
+}
+
+int main()
+{
+    indexer_options options;
+    options.threads = 2;
+    options.account = account;
+    options.chunk_bytes = 256;
+    trace_indexer indexer(options);
+    std::istringstream in(build_trace());
+    auto stats = indexer.run(in);
+    const auto &shards = indexer.get_shards();
+    expect(stats.records == 10 && stats.actions == 9, "wrong record or action count");
+
+    auto first = find_row(shards, &shard_state::candles, candle_key{1, hour});
+    expect(first != nullptr, "no first hour candle of pool 1");
+    if (first)
+    {
+        expect(first->base_symbol == token1.quantity.symbol && first->quote_symbol == token2.quantity.symbol, "candle base is not token1");
+        expect(near(first->open, 2.0) && near(first->high, 2.1) && near(first->low, 1.9) && near(first->close, 2.1), "wrong first hour OHLC");
+        expect(first->base_volume == 10000 + 20000 + 10000 + 20000 + 5000, "wrong first hour base volume");
+        expect(first->quote_volume == 20000 + 41000 + 19000 + 38000 + 10500, "wrong first hour quote volume");
+        expect(first->trades == 5, "a settle side or a vault hop is not counted as a trade");
+    }
+
+    auto next = find_row(shards, &shard_state::candles, candle_key{1, hour + 3600});
+    expect(next != nullptr && near(next->open, 2.2) && near(next->close, 2.2) && next->trades == 1 && next->base_volume == 1000,
+           "wrong next hour candle, or a record of another account was taken");
+
+    auto hop = find_row(shards, &shard_state::candles, candle_key{2, hour});
+    expect(hop != nullptr && hop->base_symbol == token2.quantity.symbol && near(hop->close, 5000.0 / 10500) && hop->base_volume == 10500 &&
+               hop->quote_volume == 5000,
+           "wrong candle of the second vault hop");
+
+    auto fee1 = find_row(shards, &shard_state::fees, fee_key{1, token_contract, token1.quantity.symbol});
+    expect(fee1 != nullptr && fee1->pool_fee == 20 + 20 + 10 + 2 && fee1->platform_fee == 5 + 5 + 3 + 1, "wrong token1 fees of pool 1");
+    auto fee2 = find_row(shards, &shard_state::fees, fee_key{1, token_contract, token2.quantity.symbol});
+    expect(fee2 != nullptr && fee2->pool_fee == 82 + 76 && fee2->platform_fee == 20 + 19, "wrong token2 fees of pool 1");
+    auto hop_fee = find_row(shards, &shard_state::fees, fee_key{2, token_contract, token2.quantity.symbol});
+    expect(hop_fee != nullptr && hop_fee->pool_fee == 21 && hop_fee->platform_fee == 5, "wrong fees of the second vault hop");
+
+    auto lp = find_row(shards, &shard_state::positions, position_key{1, to_name("alice")});
+    expect(lp != nullptr && lp->lq_amount == 1200 && lp->token1_amount == 120 && lp->token2_amount == 240, "wrong LP position amounts");
+    expect(lp != nullptr && lp->deposits == 2 && lp->withdrawals == 1 && lp->last_time == hour + 70, "wrong LP position counts");
+
+    if (failures > 0)
+    {
+        std::fprintf(stderr, "%d failures\n", failures);
+        return 1;
+    }
+    std::printf("indexer_test passed\n");
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include "indexer.hpp"
+
+static void usage(const char *program)
+{
+    std::fprintf(stderr,
+                 "Usage: %s [OPTION]... TRACE_FILE OUTPUT_DIR\n"
+                 "  -t N        Worker threads, one shard each. (Default: hardware concurrency)\n"
+                 "  -i SECONDS  Candle interval. (Default: 3600)\n"
+                 "  -a ACCOUNT  Only take actions of this contract account.\n"
+                 "Output covers every trade only if the contract's own setntfpolicy row forces\n"
+                 "notifications on, accounts that opted out are missing otherwise.\n",
+                 program);
+}
+
+int main(int argc, char **argv)
+{
+    indexer_options options;
+    options.threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::string> args;
+    try
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            if ((arg == "-t" || arg == "-i" || arg == "-a") && i + 1 < argc)
+            {
+                std::string value = argv[++i];
+                if (arg == "-t")
+                    options.threads = std::stoul(value);
+                else if (arg == "-i")
+                    options.candle_interval = std::stoul(value);
+                else
+                    options.account = to_name(value);
+            }
+            else
+            {
+                args.push_back(arg);
+            }
+        }
+        if (args.size() != 2)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+
+        std::ifstream in(args[0], std::ios::binary);
+        check(in.good(), "main : can not open trace file");
+        trace_indexer indexer(options);
+        auto stats = indexer.run(in);
+        std::filesystem::create_directories(args[1]);
+        indexer.write(args[1]);
+        std::printf("%llu records, %llu actions indexed, %llu bytes\n", (unsigned long long)stats.records,
+                    (unsigned long long)stats.actions, (unsigned long long)stats.bytes);
+    }
+    catch (const std::exception &e)
+    {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
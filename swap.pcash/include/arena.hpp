@@ -0,0 +1,115 @@
+#pragma once
+#include <eosio/eosio.hpp>
+#include <eosio/action.hpp>
+#include <map>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+using namespace eosio;
+
+//Bump-pointer arena for per-action temporaries: memo parsing, pair hashing and inline action packing.
+//Every action runs in a fresh instance, so the arena is never reset. Freeing the newest block gives its space
+//back, older blocks stay until the action ends. Requests beyond the buffer fall back to the heap.
+constexpr size_t scratch_arena_size = 8192;
+
+class scratch_arena
+{
+public:
+    void *allocate(const size_t &size, const size_t &align)
+    {
+        //Empty blocks take a byte, so no two live blocks share the newest address
+        auto bytes = size > 0 ? size : 1;
+        auto offset = (used + align - 1) & ~(align - 1);
+        if (offset + bytes > scratch_arena_size)
+        {
+            return ::operator new(size);
+        }
+        last = used;
+        used = offset + bytes;
+        return buffer + offset;
+    }
+
+    void deallocate(void *ptr)
+    {
+        if (ptr < (void *)buffer || ptr >= (void *)(buffer + scratch_arena_size))
+        {
+            ::operator delete(ptr);
+            return;
+        }
+        if ((char *)ptr >= buffer + last && last < used)
+        {
+            used = last;
+        }
+    }
+
+    size_t get_used() const
+    {
+        return used;
+    }
+
+private:
+    //Every member has an initializer, so the arena is constant-initialized and needs no global constructor
+    alignas(16) char buffer[scratch_arena_size] = {};
+    size_t used = 0;
+    size_t last = 0;
+};
+
+inline scratch_arena scratch;
+
+template <typename T>
+struct scratch_allocator
+{
+    using value_type = T;
+
+    scratch_allocator() = default;
+    template <typename U>
+    scratch_allocator(const scratch_allocator<U> &) {}
+
+    T *allocate(const size_t &n)
+    {
+        return (T *)scratch.allocate(n * sizeof(T), alignof(T));
+    }
+
+    void deallocate(T *ptr, const size_t &)
+    {
+        scratch.deallocate(ptr);
+    }
+
+    template <typename U>
+    bool operator==(const scratch_allocator<U> &) const
+    {
+        return true;
+    }
+    template <typename U>
+    bool operator!=(const scratch_allocator<U> &) const
+    {
+        return false;
+    }
+};
+
+using scratch_string = std::basic_string<char, std::char_traits<char>, scratch_allocator<char>>;
+
+template <typename T>
+using scratch_vector = std::vector<T, scratch_allocator<T>>;
+
+template <typename T>
+using scratch_set = std::set<T, std::less<T>, scratch_allocator<T>>;
+
+using memo_params = std::map<scratch_string, scratch_string, std::less<>, scratch_allocator<std::pair<const scratch_string, scratch_string>>>;
+
+//Serializes the action straight into the arena in the layout of eosio::action, so neither the payload nor
+//the action goes through a heap vector. The buffer is the newest block, so its space is given back after sending.
+template <typename... Args>
+void send_scratch(const permission_level &auth, const name &account, const name &action_name, const std::tuple<Args...> &data)
+{
+    auto data_size = pack_size(data);
+    auto size = pack_size(account) + pack_size(action_name) + pack_size(unsigned_int(1)) + pack_size(auth) +
+                pack_size(unsigned_int(data_size)) + data_size;
+    auto buffer = (char *)scratch.allocate(size, 1);
+    datastream<char *> ds(buffer, size);
+    ds << account << action_name << unsigned_int(1) << auth << unsigned_int(data_size) << data;
+    internal_use_do_not_use::send_inline(buffer, size);
+    scratch.deallocate(buffer);
+}
@@ -0,0 +1,113 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+//Compact swap memo, "~" followed by unpadded base64url of LEB128 varints: flags, min amount, pool ids.
+//Only standard headers are used, so host tools decode memos with the same code as the contract.
+constexpr std::string_view compact_prefix("~");
+constexpr uint8_t max_route_length = 8;
+constexpr uint8_t compact_partial_fill = 1;
+constexpr uint8_t compact_known_flags = compact_partial_fill;
+constexpr uint8_t max_varint_bytes = 10; //a uint64 needs 10 groups of 7 bits, the last one holds only the top bit
+
+struct compact_swap
+{
+    std::array<uint64_t, max_route_length> pool_ids;
+    uint8_t pool_count = 0;
+    uint64_t min_amount = 0;
+    uint8_t flags = 0;
+};
+
+inline int8_t from_base64url(const char &c)
+{
+    if (c >= 'A' && c <= 'Z')
+        return c - 'A';
+    if (c >= 'a' && c <= 'z')
+        return c - 'a' + 26;
+    if (c >= '0' && c <= '9')
+        return c - '0' + 52;
+    if (c == '-')
+        return 62;
+    if (c == '_')
+        return 63;
+    return -1;
+}
+
+//Decodes a memo that starts with the compact prefix, false for any malformed or out of range field
+inline bool decode_compact_memo(const std::string_view &memo, compact_swap &result)
+{
+    uint32_t bits = 0;
+    uint8_t bit_count = 0;
+    uint64_t value = 0;
+    uint8_t groups = 0;
+    uint8_t field = 0;
+
+    //Base64url digits are unpacked into bytes and bytes into varints in the same pass
+    for (auto i = compact_prefix.size(); i < memo.size(); ++i)
+    {
+        auto digit = from_base64url(memo[i]);
+        if (digit < 0)
+        {
+            return false;
+        }
+        bits = (bits << 6) | (uint32_t)digit;
+        bit_count += 6;
+        if (bit_count < 8)
+        {
+            continue;
+        }
+
+        bit_count -= 8;
+        uint8_t byte = bits >> bit_count;
+        bits &= (1u << bit_count) - 1;
+        if (groups == max_varint_bytes - 1 && (byte & 0x7f) > 1)
+        {
+            return false;
+        }
+        value |= (uint64_t)(byte & 0x7f) << (7 * groups);
+        ++groups;
+        if (byte & 0x80)
+        {
+            if (groups == max_varint_bytes)
+            {
+                return false;
+            }
+            continue;
+        }
+        //A zero last group adds nothing, so a varint ending in one has a shorter encoding
+        if (groups > 1 && byte == 0)
+        {
+            return false;
+        }
+
+        //Fields go in order: flags, min amount, pool ids
+        if (field == 0)
+        {
+            //Unknown bits stay reserved, so a memo meant for a later option is never swapped without it
+            if (value & ~(uint64_t)compact_known_flags)
+            {
+                return false;
+            }
+            result.flags = value;
+        }
+        else if (field == 1)
+        {
+            result.min_amount = value;
+        }
+        else
+        {
+            if (result.pool_count == max_route_length)
+            {
+                return false;
+            }
+            result.pool_ids[result.pool_count++] = value;
+        }
+        ++field;
+        value = 0;
+        groups = 0;
+    }
+
+    //Unpadded base64 ends with at most 4 bits past the last byte, all zero, so every memo has a single encoding
+    return groups == 0 && bit_count < 6 && bits == 0 && result.pool_count > 0;
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+
+//Swap math of a pool. Each curve is a policy with static kernels, pools pick one by their curve field
+//and with_curve instantiates the caller once per curve, so a swap runs an inlined kernel without virtual calls.
+enum class curve_type : uint8_t
+{
+    constant_product = 0,
+    stable_swap = 1
+};
+
+constexpr uint64_t max_stable_amp = 10000;
+constexpr uint8_t max_curve_steps = 64;
+
+struct constant_product
+{
+    //Amount out for an amount in that is already net of fees, amp is taken only to share the stable_swap signature
+    static int64_t get_amount_out(const int64_t &reserve_in, const int64_t &reserve_out, const int64_t &amount_in, const uint64_t &)
+    {
+        auto k = (double)reserve_in * (double)reserve_out;
+        return reserve_out - (int64_t)(k / (double)(reserve_in + amount_in));
+    }
+
+    //Net amount in that gives the amount out, callers settle rounding with get_amount_out
+    static double get_amount_in(const int64_t &reserve_in, const int64_t &reserve_out, const int64_t &amount_out, const uint64_t &)
+    {
+        auto k = (double)reserve_in * (double)reserve_out;
+        return k / (double)(reserve_out - amount_out) - (double)reserve_in;
+    }
+};
+
+//Two coin StableSwap invariant A*n^n*(x+y) + D = A*D*n^n + D^(n+1)/(n^n*x*y) with n = 2.
+//Both reserves must have the same precision, so their amounts are comparable, and be positive, since the kernels divide by them
+struct stable_swap
+{
+    static double get_d(const double &x, const double &y, const uint64_t &amp)
+    {
+        auto sum = x + y;
+        if (sum == 0)
+        {
+            return 0;
+        }
+
+        auto ann = (double)amp * 4;
+        auto d = sum;
+        for (uint8_t i = 0; i < max_curve_steps; ++i)
+        {
+            auto d_p = d * d / (x * 2) * d / (y * 2);
+            auto prev = d;
+            d = (ann * sum + d_p * 2) * d / ((ann - 1) * d + d_p * 3);
+            if (std::fabs(d - prev) <= 1)
+            {
+                break;
+            }
+        }
+        return d;
+    }
+
+    //Other reserve of the invariant when one reserve is x
+    static double get_y(const double &x, const double &d, const uint64_t &amp)
+    {
+        auto ann = (double)amp * 4;
+        auto c = d * d / (x * 2) * d / (ann * 2);
+        auto b = x + d / ann;
+        auto y = d;
+        for (uint8_t i = 0; i < max_curve_steps; ++i)
+        {
+            auto prev = y;
+            y = (y * y + c) / (y * 2 + b - d);
+            if (std::fabs(y - prev) <= 1)
+            {
+                break;
+            }
+        }
+        return y;
+    }
+
+    static int64_t get_amount_out(const int64_t &reserve_in, const int64_t &reserve_out, const int64_t &amount_in, const uint64_t &amp)
+    {
+        auto d = get_d(reserve_in, reserve_out, amp);
+        auto y = get_y((double)reserve_in + amount_in, d, amp);
+        auto amount_out = (int64_t)((double)reserve_out - std::ceil(y)) - 1;
+        return amount_out > 0 ? amount_out : 0;
+    }
+
+    static double get_amount_in(const int64_t &reserve_in, const int64_t &reserve_out, const int64_t &amount_out, const uint64_t &amp)
+    {
+        auto d = get_d(reserve_in, reserve_out, amp);
+        return get_y((double)(reserve_out - amount_out), d, amp) - (double)reserve_in;
+    }
+};
+
+template <typename Kernel>
+inline auto with_curve(const uint8_t &curve, Kernel &&kernel)
+{
+    switch ((curve_type)curve)
+    {
+    case curve_type::stable_swap:
+        return kernel(stable_swap());
+    default:
+        return kernel(constant_product());
+    }
+}
@@ -0,0 +1,568 @@
+#pragma once
+#include <eosio/eosio.hpp>
+
+using namespace eosio;
+
+//Instrumentation build counts table access, inline actions and heap usage per action
+//and reports them through the instrstats action. In other builds everything below is a no-op.
+#ifdef INSTRUMENT
+    #include <algorithm>
+    #include <cstdlib>
+    #include <vector>
+
+    #define INSTR_PHASE(phase) instrument_phase_scope instr_phase_scope(instrument_phase::phase)
+    #define INSTR_INLINE_ACTION() ++instr.inline_actions
+
+enum class instrument_phase : uint8_t
+{
+    other,
+    memo,
+    lookup,
+    hash,
+    pack,
+    count
+};
+
+const uint8_t max_instr_tables = 16;
+
+struct instr_table_counters
+{
+    name table;
+    uint32_t reads = 0;
+    uint32_t writes = 0;
+    uint32_t index_ops = 0;
+    uint32_t cache_hits = 0;
+
+    EOSLIB_SERIALIZE(instr_table_counters, (table)(reads)(writes)(index_ops)(cache_hits))
+};
+
+struct instr_phase_heap
+{
+    name phase;
+    uint32_t heap_bytes = 0;
+
+    EOSLIB_SERIALIZE(instr_phase_heap, (phase)(heap_bytes))
+};
+
+struct instrument_state
+{
+    instr_table_counters tables[max_instr_tables];
+    uint8_t table_count = 0;
+    uint32_t inline_actions = 0;
+    uint32_t heap_bytes[(uint8_t)instrument_phase::count] = {};
+    uint32_t live_heap_bytes = 0;
+    uint32_t peak_heap_bytes = 0;
+    uint32_t start_pages = 0;
+    bool paused = false;
+    instrument_phase phase = instrument_phase::other;
+};
+
+//Each heap block carries its size in front, so delete can keep the live byte count
+const size_t instr_block_header = 16;
+
+//Zero-initialized, so it adds no global constructor to the action entry
+inline instrument_state instr;
+
+inline instr_table_counters &instr_table(const name &table)
+{
+    for (uint8_t i = 0; i < instr.table_count; ++i)
+    {
+        if (instr.tables[i].table == table)
+            return instr.tables[i];
+    }
+    check(instr.table_count < max_instr_tables, "instrument : too many tables");
+    auto &counters = instr.tables[instr.table_count++];
+    counters.table = table;
+    return counters;
+}
+
+inline uint32_t instr_memory_pages()
+{
+    #ifdef __wasm__
+    return __builtin_wasm_memory_size(0);
+    #else
+    return 0;
+    #endif
+}
+
+inline void *instr_allocate(const size_t &size)
+{
+    if (instr.paused)
+    {
+        auto block = (char *)malloc(size + instr_block_header);
+        *(size_t *)block = 0;
+        return block + instr_block_header;
+    }
+    instr.heap_bytes[(uint8_t)instr.phase] += size;
+    instr.live_heap_bytes += size;
+    instr.peak_heap_bytes = std::max(instr.peak_heap_bytes, instr.live_heap_bytes);
+    auto block = (char *)malloc(size + instr_block_header);
+    *(size_t *)block = size;
+    return block + instr_block_header;
+}
+
+inline void instr_free(void *ptr)
+{
+    if (ptr == nullptr)
+    {
+        return;
+    }
+    auto block = (char *)ptr - instr_block_header;
+    instr.live_heap_bytes -= *(size_t *)block;
+    free(block);
+}
+
+inline name instr_phase_name(const instrument_phase &phase)
+{
+    switch (phase)
+    {
+    case instrument_phase::memo:
+        return name("memo");
+    case instrument_phase::lookup:
+        return name("lookup");
+    case instrument_phase::hash:
+        return name("hash");
+    case instrument_phase::pack:
+        return name("pack");
+    default:
+        return name("other");
+    }
+}
+
+struct instrument_phase_scope
+{
+    instrument_phase previous;
+
+    explicit instrument_phase_scope(const instrument_phase &phase) : previous(instr.phase)
+    {
+        instr.phase = phase;
+    }
+    ~instrument_phase_scope()
+    {
+        instr.phase = previous;
+    }
+};
+
+//Keeps the bookkeeping of the instrumentation itself out of the heap numbers
+struct instrument_pause
+{
+    bool previous;
+
+    instrument_pause() : previous(instr.paused)
+    {
+        instr.paused = true;
+    }
+    ~instrument_pause()
+    {
+        instr.paused = previous;
+    }
+};
+
+void *operator new(size_t size)
+{
+    return instr_allocate(size);
+}
+
+void *operator new[](size_t size)
+{
+    return instr_allocate(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    instr_free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    instr_free(ptr);
+}
+
+//Sized forms too, so deletes the compiler emits with a size are counted instead of going to the library
+void operator delete(void *ptr, size_t) noexcept
+{
+    instr_free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+    instr_free(ptr);
+}
+
+template <name::raw TableName, typename Owner, typename Index>
+class instrumented_index;
+
+template <typename Table>
+struct instr_index_count;
+
+template <name::raw TableName, typename T, typename... Indices>
+struct instr_index_count<multi_index<TableName, T, Indices...>>
+{
+    static constexpr uint32_t value = sizeof...(Indices);
+};
+
+//Wraps a table or index iterator so db_next/db_previous style calls behind ++ and -- are counted
+template <typename Owner, typename Iterator>
+class instrumented_iterator : public Iterator
+{
+public:
+    instrumented_iterator() = default;
+    instrumented_iterator(const Owner *owner, const Iterator &it) : Iterator(it), owner(owner) {}
+
+    instrumented_iterator &operator++()
+    {
+        owner->count_step(1);
+        Iterator::operator++();
+        owner->count_load(*this);
+        return *this;
+    }
+
+    instrumented_iterator operator++(int)
+    {
+        auto prev = *this;
+        ++*this;
+        return prev;
+    }
+
+    instrumented_iterator &operator--()
+    {
+        //Stepping back from end first asks for the end iterator
+        owner->count_step(owner->is_end(*this) ? 2 : 1);
+        Iterator::operator--();
+        owner->count_load(*this);
+        return *this;
+    }
+
+    instrumented_iterator operator--(int)
+    {
+        auto prev = *this;
+        --*this;
+        return prev;
+    }
+
+private:
+    const Owner *owner = nullptr;
+};
+
+//Counts database intrinsics the way multi_index issues them: lookups served from the object cache of the
+//table instance are cache hits, a missed find is db_find plus db_get, an iterator step is one call plus
+//db_get when the row is not cached yet. Secondary index key updates on modify are not counted.
+template <name::raw TableName, typename Table>
+class instrumented_table : public Table
+{
+public:
+    using Table::Table;
+    using base_iterator = typename Table::const_iterator;
+    using const_iterator = instrumented_iterator<instrumented_table, base_iterator>;
+    using row_type = std::decay_t<decltype(*std::declval<base_iterator>())>;
+
+    template <typename... Args>
+    const_iterator find(Args &&... args) const
+    {
+        INSTR_PHASE(lookup);
+        return count_find(Table::find(std::forward<Args>(args)...), args...);
+    }
+
+    template <typename... Args>
+    const_iterator require_find(Args &&... args) const
+    {
+        INSTR_PHASE(lookup);
+        return count_find(Table::require_find(std::forward<Args>(args)...), args...);
+    }
+
+    template <typename... Args>
+    decltype(auto) get(Args &&... args) const
+    {
+        INSTR_PHASE(lookup);
+        const auto &obj = Table::get(std::forward<Args>(args)...);
+        count_find(Table::iterator_to(obj), obj.primary_key());
+        return obj;
+    }
+
+    const_iterator begin() const
+    {
+        INSTR_PHASE(lookup);
+        return count_bound(Table::begin());
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(this, Table::end());
+    }
+
+    template <typename... Args>
+    const_iterator lower_bound(Args &&... args) const
+    {
+        INSTR_PHASE(lookup);
+        return count_bound(Table::lower_bound(std::forward<Args>(args)...));
+    }
+
+    template <typename... Args>
+    const_iterator upper_bound(Args &&... args) const
+    {
+        INSTR_PHASE(lookup);
+        return count_bound(Table::upper_bound(std::forward<Args>(args)...));
+    }
+
+    const_iterator iterator_to(const row_type &obj) const
+    {
+        return const_iterator(this, Table::iterator_to(obj));
+    }
+
+    uint64_t available_primary_key() const
+    {
+        //The first call walks to the last row, later calls use the cached next key
+        if (!next_key_counted)
+        {
+            next_key_counted = true;
+            auto last = end();
+            if (begin() != last)
+            {
+                --last;
+            }
+        }
+        return Table::available_primary_key();
+    }
+
+    template <typename... Args>
+    const_iterator emplace(Args &&... args)
+    {
+        INSTR_PHASE(lookup);
+        auto &counters = instr_table(name(TableName));
+        ++counters.writes;
+        counters.index_ops += instr_index_count<Table>::value;
+        auto it = Table::emplace(std::forward<Args>(args)...);
+        mark_loaded(it->primary_key());
+        return const_iterator(this, it);
+    }
+
+    template <typename... Args>
+    void modify(Args &&... args)
+    {
+        INSTR_PHASE(lookup);
+        ++instr_table(name(TableName)).writes;
+        Table::modify(std::forward<Args>(args)...);
+    }
+
+    const_iterator erase(const base_iterator &it)
+    {
+        INSTR_PHASE(lookup);
+        const_iterator next(this, it);
+        ++next;
+        count_erase(it->primary_key());
+        Table::erase(it);
+        return next;
+    }
+
+    void erase(const row_type &obj)
+    {
+        INSTR_PHASE(lookup);
+        count_erase(obj.primary_key());
+        Table::erase(obj);
+    }
+
+    template <name::raw IndexName>
+    auto get_index() const
+    {
+        using index_type = decltype(Table::template get_index<IndexName>());
+        return instrumented_index<TableName, instrumented_table, index_type>(this, Table::template get_index<IndexName>());
+    }
+
+    void count_step(const uint32_t &calls) const
+    {
+        instr_table(name(TableName)).reads += calls;
+    }
+
+    void count_load(const base_iterator &it) const
+    {
+        if (it != Table::end())
+        {
+            count_load(it->primary_key(), 1);
+        }
+    }
+
+    //A row that is not cached yet costs miss_reads calls to bring into the cache
+    void count_load(const uint64_t &primary_key, const uint32_t &miss_reads) const
+    {
+        auto &counters = instr_table(name(TableName));
+        if (is_loaded(primary_key))
+        {
+            ++counters.cache_hits;
+        }
+        else
+        {
+            counters.reads += miss_reads;
+            mark_loaded(primary_key);
+        }
+    }
+
+    bool is_end(const base_iterator &it) const
+    {
+        return it == Table::end();
+    }
+
+private:
+    template <typename Key, typename... Rest>
+    const_iterator count_find(const base_iterator &it, const Key &key, const Rest &...) const
+    {
+        auto &counters = instr_table(name(TableName));
+        if (is_loaded((uint64_t)key))
+        {
+            ++counters.cache_hits;
+        }
+        else
+        {
+            ++counters.reads;
+            if (it != Table::end())
+            {
+                ++counters.reads;
+                mark_loaded((uint64_t)key);
+            }
+        }
+        return const_iterator(this, it);
+    }
+
+    const_iterator count_bound(const base_iterator &it) const
+    {
+        count_step(1);
+        count_load(it);
+        return const_iterator(this, it);
+    }
+
+    void count_erase(const uint64_t &primary_key)
+    {
+        auto &counters = instr_table(name(TableName));
+        ++counters.writes;
+        counters.index_ops += instr_index_count<Table>::value;
+        instrument_pause pause;
+        loaded.erase(std::remove(loaded.begin(), loaded.end(), primary_key), loaded.end());
+    }
+
+    bool is_loaded(const uint64_t &primary_key) const
+    {
+        return std::find(loaded.begin(), loaded.end(), primary_key) != loaded.end();
+    }
+
+    void mark_loaded(const uint64_t &primary_key) const
+    {
+        instrument_pause pause;
+        loaded.push_back(primary_key);
+    }
+
+    mutable std::vector<uint64_t> loaded;
+    mutable bool next_key_counted = false;
+};
+
+template <name::raw TableName, typename Owner, typename Index>
+class instrumented_index : public Index
+{
+public:
+    using base_iterator = typename Index::const_iterator;
+    using const_iterator = instrumented_iterator<instrumented_index, base_iterator>;
+
+    instrumented_index(const Owner *owner, const Index &index) : Index(index), owner(owner) {}
+
+    template <typename... Args>
+    const_iterator find(Args &&... args) const
+    {
+        INSTR_PHASE(lookup);
+        return count_bound(Index::find(std::forward<Args>(args)...));
+    }
+
+    template <typename... Args>
+    decltype(auto) get(Args &&... args) const
+    {
+        INSTR_PHASE(lookup);
+        const auto &obj = Index::get(std::forward<Args>(args)...);
+        count_step(1);
+        owner->count_load(obj.primary_key(), 2);
+        return obj;
+    }
+
+    const_iterator begin() const
+    {
+        INSTR_PHASE(lookup);
+        return count_bound(Index::begin());
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(this, Index::end());
+    }
+
+    template <typename... Args>
+    const_iterator lower_bound(Args &&... args) const
+    {
+        INSTR_PHASE(lookup);
+        return count_bound(Index::lower_bound(std::forward<Args>(args)...));
+    }
+
+    template <typename... Args>
+    const_iterator upper_bound(Args &&... args) const
+    {
+        INSTR_PHASE(lookup);
+        return count_bound(Index::upper_bound(std::forward<Args>(args)...));
+    }
+
+    template <typename T>
+    const_iterator iterator_to(const T &obj) const
+    {
+        return const_iterator(this, Index::iterator_to(obj));
+    }
+
+    template <typename... Args>
+    void modify(Args &&... args)
+    {
+        INSTR_PHASE(lookup);
+        count_write();
+        Index::modify(std::forward<Args>(args)...);
+    }
+
+    const_iterator erase(const base_iterator &it)
+    {
+        INSTR_PHASE(lookup);
+        count_write();
+        return const_iterator(this, Index::erase(it));
+    }
+
+    void count_step(const uint32_t &calls) const
+    {
+        instr_table(name(TableName)).index_ops += calls;
+    }
+
+    //Secondary lookups resolve the row through a primary find
+    void count_load(const base_iterator &it) const
+    {
+        if (it != Index::end())
+        {
+            owner->count_load(it->primary_key(), 2);
+        }
+    }
+
+    bool is_end(const base_iterator &it) const
+    {
+        return it == Index::end();
+    }
+
+private:
+    const_iterator count_bound(const base_iterator &it) const
+    {
+        count_step(1);
+        count_load(it);
+        return const_iterator(this, it);
+    }
+
+    void count_write() const
+    {
+        ++instr_table(name(TableName)).writes;
+    }
+
+    const Owner *owner;
+};
+#else
+    #define INSTR_PHASE(phase)
+    #define INSTR_INLINE_ACTION()
+
+template <name::raw TableName, typename Table>
+using instrumented_table = Table;
+#endif
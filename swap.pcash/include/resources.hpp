@@ -1,18 +1,24 @@
 #pragma once
 #include <eosio/eosio.hpp>
 #include <eosio/crypto.hpp>
+#include <eosio/binary_extension.hpp>
+#include <limits>
+#include <string_view>
+#include "instrument.hpp"
+#include "arena.hpp"
+#include "compact_memo.hpp"
 
 using namespace eosio;
 
 #ifdef DEBUG
-    const uint32_t min_inh_period = 2;
-    const uint32_t max_inh_period = 5;
+    constexpr uint32_t min_inh_period = 2;
+    constexpr uint32_t max_inh_period = 5;
 
     constexpr name TOKEN_PCASH_ACCOUNT("cash.token");
     constexpr name FEE_RECEIVER_ACCOUNT("fee.pcash");
 #else
-    const uint32_t min_inh_period = 86400; //1 day
-    const uint32_t max_inh_period = 315360000; //10 years in sec
+    constexpr uint32_t min_inh_period = 86400; //1 day
+    constexpr uint32_t max_inh_period = 315360000; //10 years in sec
 
     #ifdef PREPROD
         constexpr name TOKEN_PCASH_ACCOUNT("cashescashes");
@@ -23,18 +29,31 @@ using namespace eosio;
     #endif
 #endif
 
-const std::string swap_prefix("swap:");
-const std::string deposit_prefix("deposit:");
+//Constants are constexpr so that no global constructors run on action entry
+constexpr std::string_view swap_prefix("swap:");
+constexpr std::string_view deposit_prefix("deposit:");
+constexpr std::string_view vault_prefix("vault:");
+constexpr std::string_view zap_prefix("zap:");
+constexpr std::string_view route_prefix("r");
 
 constexpr symbol fee_percent("PERCENT", 2);
-const asset pool_fee(20, fee_percent);
-const asset platform_fee(5, fee_percent);
+constexpr int64_t pool_fee_amount = 20;
+constexpr int64_t platform_fee_amount = 5;
 
-const int64_t min_swap_amount = 800;
+constexpr int64_t min_swap_amount = 800;
+constexpr uint8_t max_inverse_steps = 16;
+constexpr uint8_t max_fill_steps = 64;
+constexpr uint8_t max_batch_pools = 32;
+constexpr uint8_t max_pool_routes = 64; //per owner and pool, so one account can not fill a pool for the others
+
+constexpr uint8_t volume_buckets_count = 24;
+constexpr uint32_t volume_bucket_period = 3600; //1 hour
+
+constexpr uint64_t row_overhead_bytes = 112; //billable overhead of one table or index row on top of its packed data
 
 constexpr symbol inh_percent("PERCENT", 1);
-const asset min_percent(1, inh_percent);
-const asset max_percent(1000, inh_percent);
+constexpr int64_t min_percent_amount = 1;
+constexpr int64_t max_percent_amount = 1000;
 
 struct transfer_action
 {
@@ -46,6 +65,57 @@ struct transfer_action
     EOSLIB_SERIALIZE(transfer_action, (from)(to)(quantity)(memo))
 };
 
+struct token_pair
+{
+    extended_symbol token1;
+    extended_symbol token2;
+
+    EOSLIB_SERIALIZE(token_pair, (token1)(token2))
+};
+
+struct transfer_record
+{
+    name to;
+    asset quantity;
+    std::string memo;
+
+    EOSLIB_SERIALIZE(transfer_record, (to)(quantity)(memo))
+};
+
+//Reserves and fees of a pool read once, so the swap math can be run again without table lookups
+struct pool_quote
+{
+    extended_asset reserve1;
+    extended_asset reserve2;
+    asset pool_fee;
+    asset platform_fee;
+    name fee_receiver;
+    uint8_t curve;
+    uint64_t amp;
+};
+
+//One side of a settled batch: intents selling the same token, totalled like a single swap
+struct batch_side
+{
+    extended_asset token_in;
+    extended_asset token_out;
+    extended_asset pool_fee;
+    extended_asset platform_fee;
+
+    EOSLIB_SERIALIZE(batch_side, (token_in)(token_out)(pool_fee)(platform_fee))
+};
+
+//Intent of a settled batch, a refunded intent has a zero token_out
+struct batch_fill
+{
+    uint64_t intent_id;
+    name owner;
+    asset token_in;
+    asset token_out;
+
+    EOSLIB_SERIALIZE(batch_fill, (intent_id)(owner)(token_in)(token_out))
+};
+
 struct deposit
 {
     name from;
@@ -55,25 +125,102 @@ struct deposit
     EOSLIB_SERIALIZE(deposit, (from)(quantity)(memo))
 };
 
-bool operator==(const deposit &lhs, const deposit &rhs)
+inline bool operator==(const deposit &lhs, const deposit &rhs)
 {
     return (lhs.from == rhs.from && lhs.quantity.quantity.symbol == rhs.quantity.quantity.symbol && lhs.quantity.quantity.amount == rhs.quantity.quantity.amount && lhs.memo == rhs.memo) ? true : false;
 }
 
-std::string to_string(const extended_symbol &token)
+inline bool has_prefix(const std::string_view &str, const std::string_view &prefix)
+{
+    return str.substr(0, prefix.size()) == prefix;
+}
+
+//Joins prefix and message only when the check fails, passing checks do not allocate
+inline void check(bool pred, const std::string_view &prefix, const char *msg)
+{
+    if (!pred)
+    {
+        std::string text(prefix);
+        text += msg;
+        eosio::check(false, text);
+    }
+}
+
+inline uint64_t to_uint64(const std::string_view &str)
+{
+    uint64_t value = 0;
+    for (auto c : str)
+    {
+        uint64_t digit = c - '0';
+        check(value <= (std::numeric_limits<uint64_t>::max() - digit) / 10, "to_uint64 : number is out of range");
+        value = value * 10 + digit;
+    }
+    return value;
+}
+
+//Same text as symbol_code::to_string and name::to_string, written without a temporary std::string
+inline void append_symbol_code(scratch_string &str, const symbol_code &code)
+{
+    for (auto value = code.raw(); value > 0; value >>= 8)
+    {
+        str += (char)(value & 0xff);
+    }
+}
+
+inline void append_name(scratch_string &str, const name &value)
+{
+    static const char *charmap = ".12345abcdefghijklmnopqrstuvwxyz";
+    char buffer[13];
+    auto tmp = value.value;
+    for (uint32_t i = 0; i <= 12; ++i)
+    {
+        buffer[12 - i] = charmap[tmp & (i == 0 ? 0x0f : 0x1f)];
+        tmp >>= (i == 0 ? 4 : 5);
+    }
+
+    auto size = 13;
+    while (size > 0 && buffer[size - 1] == '.')
+    {
+        --size;
+    }
+    str.append(buffer, size);
+}
+
+inline scratch_string to_string(const extended_symbol &token)
 {
-    std::string str = token.get_symbol().code().to_string() + "@" + token.get_contract().to_string();
+    scratch_string str;
+    append_symbol_code(str, token.get_symbol().code());
+    str += '@';
+    append_name(str, token.get_contract());
     return str;
 }
 
-std::string to_string(const extended_asset &token)
+inline scratch_string to_string(const extended_asset &token)
 {
-    std::string str = std::to_string(token.quantity.amount) + " " + to_string(token.get_extended_symbol());
+    auto amount = std::to_string(token.quantity.amount);
+    scratch_string str(amount.data(), amount.size());
+    str += ' ';
+    str += to_string(token.get_extended_symbol());
     return str;
 }
 
-checksum256 to_pair_hash(const extended_symbol &token1, const extended_symbol &token2)
+//Pending intents of a vault row after adding a change to them, rows written before the count existed start from zero
+inline uint32_t count_pending_intents(const binary_extension<uint32_t> &pending, const int32_t &intents)
+{
+    auto count = pending.value_or();
+    return intents < 0 && count < (uint32_t)-intents ? 0 : count + intents;
+}
+
+inline uint128_t to_token_key(const extended_symbol &token)
+{
+    return (uint128_t)token.get_contract().value << 64 | token.get_symbol().code().raw();
+}
+
+inline checksum256 to_pair_hash(const extended_symbol &token1, const extended_symbol &token2)
 {
-    std::string str = to_string(token1) + "/" + to_string(token2);
+    INSTR_PHASE(hash);
+    auto str = to_string(token1);
+    str += '/';
+    str += to_string(token2);
     return sha256(str.data(), str.size());
 }
\ No newline at end of file
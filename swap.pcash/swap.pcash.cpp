@@ -3,19 +3,76 @@
 swap::swap(name receiver, name code, datastream<const char *> ds)
     : contract::contract(receiver, code, ds)
 {
+#ifdef INSTRUMENT
+    instr.start_pages = instr_memory_pages();
+#endif
 }
 
+//Runs at the end of every action and notification, so pools are stamped in one place whatever changed them
+swap::~swap()
+{
+    flush_pool_seqs();
+#ifdef INSTRUMENT
+    report_instr_stats();
+#endif
+}
+
+#ifdef INSTRUMENT
+void swap::report_instr_stats()
+{
+    //Actions the contract sent itself (issue, retire, transfer and the notifications of its own payouts) are part
+    //of the action that sent them, which already counts them as inline actions, so they send no report of their own
+    if ((instr.table_count == 0 && instr.inline_actions == 0) || get_sender() == get_self())
+    {
+        return;
+    }
+
+    auto inline_actions = instr.inline_actions;
+    auto peak_heap_bytes = instr.peak_heap_bytes;
+    auto page_growth = instr_memory_pages() - instr.start_pages;
+    auto arena_bytes = (uint32_t)scratch.get_used();
+    uint32_t heap_bytes[(uint8_t)instrument_phase::count];
+    std::copy(std::begin(instr.heap_bytes), std::end(instr.heap_bytes), std::begin(heap_bytes));
+
+    std::vector<instr_table_counters> tables(instr.tables, instr.tables + instr.table_count);
+    std::vector<instr_phase_heap> heap;
+    for (uint8_t i = 0; i < (uint8_t)instrument_phase::count; ++i)
+    {
+        heap.push_back({instr_phase_name((instrument_phase)i), heap_bytes[i]});
+    }
+
+    //Blocks still alive are freed after the report, so their bytes stay counted
+    auto live_heap_bytes = instr.live_heap_bytes;
+    instr = instrument_state();
+    instr.live_heap_bytes = live_heap_bytes;
+
+    send_scratch(
+        permission_level{get_self(), name("active")},
+        get_self(),
+        name("instrstats"),
+        std::make_tuple(get_first_receiver(), tables, inline_actions, heap, peak_heap_bytes, page_growth, arena_bytes));
+}
+#endif
+
+#ifdef INSTRUMENT
+void swap::instr_stats(const name &code, const std::vector<instr_table_counters> &tables, const uint32_t &inline_actions, const std::vector<instr_phase_heap> &heap,
+                       const uint32_t &peak_heap_bytes, const uint32_t &page_growth, const uint32_t &arena_bytes)
+{
+    require_auth(get_self());
+}
+#endif
+
 void swap::open(const name &owner, const symbol &symbol, const name &ram_payer)
 {
     require_auth(ram_payer);
     check(is_account(owner), "open : owner account does not exist");
 
     auto sym_code_raw = symbol.code().raw();
-    stats statstable(get_self(), sym_code_raw);
+    auto &statstable = get_stats(symbol.code());
     const auto &st = statstable.get(sym_code_raw, "open : symbol does not exist");
     check(st.supply.symbol == symbol, "open : symbol precision mismatch");
 
-    accounts _accounts(get_self(), owner.value);
+    auto &_accounts = get_accounts(owner);
     auto it = _accounts.find(sym_code_raw);
 
     if (it == _accounts.end())
@@ -31,7 +88,7 @@ void swap::open(const name &owner, const symbol &symbol, const name &ram_payer)
 void swap::close(const name &owner, const symbol &symbol)
 {
     require_auth(owner);
-    accounts _accounts(get_self(), owner.value);
+    auto &_accounts = get_accounts(owner);
     auto it = _accounts.find(symbol.code().raw());
     check(it != _accounts.end(), "close : Balance row already deleted or never existed. Action won't have any effect.");
     check(it->balance.amount == 0, "close : Cannot close because the balance is not zero.");
@@ -43,6 +100,55 @@ void swap::close(const name &owner, const symbol &symbol)
     }
 }
 
+void swap::open_many(const name &owner, const std::vector<symbol> &symbols, const name &ram_payer)
+{
+    require_auth(ram_payer);
+    check(is_account(owner), "open_many : owner account does not exist");
+    check(!symbols.empty(), "open_many : symbols list is empty");
+
+    auto &_accounts = get_accounts(owner);
+    bool is_created = false;
+    for (const auto &sym : symbols)
+    {
+        auto &statstable = get_stats(sym.code());
+        const auto &st = statstable.get(sym.code().raw(), "open_many : symbol does not exist");
+        check(st.supply.symbol == sym, "open_many : symbol precision mismatch");
+
+        if (_accounts.find(sym.code().raw()) == _accounts.end())
+        {
+            _accounts.emplace(ram_payer, [&](auto &a) {
+                a.balance = asset(0, sym);
+            });
+            is_created = true;
+        }
+    }
+
+    if (is_created)
+    {
+        create_inheritance(owner, ram_payer);
+    }
+}
+
+void swap::close_many(const name &owner, const std::vector<symbol> &symbols)
+{
+    require_auth(owner);
+    check(!symbols.empty(), "close_many : symbols list is empty");
+
+    auto &_accounts = get_accounts(owner);
+    for (const auto &sym : symbols)
+    {
+        auto it = _accounts.find(sym.code().raw());
+        check(it != _accounts.end(), "close_many : Balance row already deleted or never existed. Action won't have any effect.");
+        check(it->balance.amount == 0, "close_many : Cannot close because the balance is not zero.");
+        _accounts.erase(it);
+    }
+
+    if (_accounts.begin() == _accounts.end())
+    {
+        close_inheritance(owner);
+    }
+}
+
 void swap::create_token(const name &issuer, const asset &maximum_supply)
 {
     require_auth(get_self());
@@ -53,7 +159,7 @@ void swap::create_token(const name &issuer, const asset &maximum_supply)
     check(maximum_supply.is_valid(), "create_token : invalid supply");
     check(maximum_supply.amount > 0, "create_token : max-supply must be positive");
 
-    stats statstable(get_self(), sym.code().raw());
+    auto &statstable = get_stats(sym.code());
     auto existing = statstable.find(sym.code().raw());
     check(existing == statstable.end(), "create_token : token with symbol already exists");
 
@@ -67,13 +173,7 @@ void swap::create_token(const name &issuer, const asset &maximum_supply)
 void swap::withdraw(const name &owner, const asset &lq_tokens)
 {
     require_auth(owner);
-    check(is_pool_exist(lq_tokens.symbol.code()), "withdraw : pool is not exist");
-    auto pool_id = get_pool_id(lq_tokens.symbol.code());
-    check(lq_tokens.amount > 0, "withdraw : amount should be positive");
-    auto [token1, token2] = count_earnings_amounts(lq_tokens);
-    check(is_account_exist(owner, token1.get_extended_symbol()), "withdraw : account is not exist");
-    check(is_account_exist(owner, token2.get_extended_symbol()), "withdraw : account is not exist");
-    sub_pool_balance(pool_id, token1, token2);
+    auto [pool_id, token1, token2] = do_withdraw(owner, lq_tokens, "withdraw : ");
     extend_inheritance(owner, owner);
     send_retire(owner, lq_tokens, "swap.pcash: withdraw");
     send_transfer(token1.contract, owner, token1.quantity, "swap.pcash: withdraw");
@@ -81,6 +181,79 @@ void swap::withdraw(const name &owner, const asset &lq_tokens)
     send_rmv_lq_details(pool_id, owner, lq_tokens, token1, token2);
 }
 
+void swap::withdraw_many(const name &owner, const std::vector<asset> &lq_tokens)
+{
+    require_auth(owner);
+    check(!lq_tokens.empty(), "withdraw_many : lq tokens list is empty");
+
+    std::set<symbol_code> codes;
+    std::map<extended_symbol, extended_asset> payouts;
+    std::vector<std::tuple<uint64_t, asset, extended_asset, extended_asset>> details;
+
+    for (const auto &lq : lq_tokens)
+    {
+        check(codes.insert(lq.symbol.code()).second, "withdraw_many : lq tokens must be unique");
+        auto [pool_id, token1, token2] = do_withdraw(owner, lq, "withdraw_many : ");
+        send_retire(owner, lq, "swap.pcash: withdraw");
+
+        for (const auto &token : {token1, token2})
+        {
+            auto it = payouts.find(token.get_extended_symbol());
+            if (it == payouts.end())
+            {
+                payouts.emplace(token.get_extended_symbol(), token);
+            }
+            else
+            {
+                it->second += token;
+            }
+        }
+        details.emplace_back(pool_id, lq, token1, token2);
+    }
+
+    extend_inheritance(owner, owner);
+
+    for (const auto &[token, payout] : payouts)
+    {
+        if (payout.quantity.amount > 0)
+        {
+            send_transfer(payout.contract, owner, payout.quantity, "swap.pcash: withdraw");
+        }
+    }
+
+    for (const auto &[pool_id, lq, token1, token2] : details)
+    {
+        send_rmv_lq_details(pool_id, owner, lq, token1, token2);
+    }
+}
+
+void swap::zap_out(const name &owner, const asset &lq_tokens, const extended_symbol &token, const uint64_t &min_amount)
+{
+    require_auth(owner);
+    check(min_amount > 0, "zap_out : invalid min amount");
+    auto [pool_id, token1, token2] = do_remove_liquidity(lq_tokens, "zap_out : ");
+    check(token == token1.get_extended_symbol() || token == token2.get_extended_symbol(), "zap_out : token is not matched with pool");
+    auto [keep, sell] = token == token1.get_extended_symbol() ? std::make_tuple(token1, token2) : std::make_tuple(token2, token1);
+    check(is_account_exist(owner, keep.get_extended_symbol()), "zap_out : account is not exist");
+    extend_inheritance(owner, owner);
+    send_retire(owner, lq_tokens, "swap.pcash: withdraw");
+
+    auto total = keep;
+    if (sell.quantity.amount >= min_swap_amount)
+    {
+        total += do_swap_route(owner, sell, std::vector<uint64_t>{pool_id}, false, false, "zap_out : ");
+    }
+    else if (sell.quantity.amount > 0)
+    {
+        //Too small to swap, so the other side is paid out as is
+        check(is_account_exist(owner, sell.get_extended_symbol()), "zap_out : account is not exist");
+        send_transfer(sell.contract, owner, sell.quantity, "swap.pcash: withdraw");
+    }
+    check(total.quantity.amount >= min_amount, "zap_out : amount out less than min required");
+    send_transfer(total.contract, owner, total.quantity, "swap.pcash: withdraw");
+    send_rmv_lq_details(pool_id, owner, lq_tokens, token1, token2);
+}
+
 void swap::issue(const name &to, const asset &quantity, const std::string &memo)
 {
     check(is_account(to), "issue : to account is not exist");
@@ -88,7 +261,7 @@ void swap::issue(const name &to, const asset &quantity, const std::string &memo)
     check(sym.is_valid(), "issue : invalid symbol name");
     check(memo.size() <= 256, "issue : memo has more than 256 bytes");
 
-    stats statstable(get_self(), sym.code().raw());
+    auto &statstable = get_stats(sym.code());
     auto existing = statstable.find(sym.code().raw());
     check(existing != statstable.end(), "issue : token with symbol does not exist, create token before issue");
     const auto &st = *existing;
@@ -115,7 +288,7 @@ void swap::retire(const name &from, const asset &quantity, const std::string &me
     check(sym.is_valid(), "retire : invalid symbol name");
     check(memo.size() <= 256, "retire : memo has more than 256 bytes");
 
-    stats statstable(get_self(), sym.code().raw());
+    auto &statstable = get_stats(sym.code());
     auto existing = statstable.find(sym.code().raw());
     check(existing != statstable.end(), "retire : token with symbol does not exist");
     const auto &st = *existing;
@@ -152,7 +325,7 @@ void swap::transfer_token(const name &from, const name &to,
     require_auth(from);
     check(is_account(to), "transfer_token : to account does not exist");
     auto sym = quantity.symbol.code();
-    stats statstable(get_self(), sym.raw());
+    auto &statstable = get_stats(sym);
     const auto &st = statstable.get(sym.raw());
 
     require_recipient(from);
@@ -171,6 +344,39 @@ void swap::transfer_token(const name &from, const name &to,
     on_transfer_self_token(from, to, quantity, memo); 
 }
 
+void swap::transfer_many(const name &from, const std::vector<transfer_record> &transfers)
+{
+    require_auth(from);
+    check(!transfers.empty(), "transfer_many : transfers list is empty");
+    auto sym = transfers.front().quantity.symbol;
+    auto &statstable = get_stats(sym.code());
+    const auto &st = statstable.get(sym.code().raw());
+    check(sym == st.supply.symbol, "transfer_many : symbol precision mismatch");
+
+    asset total(0, sym);
+    for (const auto &t : transfers)
+    {
+        check(from != t.to, "transfer_many : cannot transfer to self");
+        check(is_account(t.to), "transfer_many : to account does not exist");
+        check(t.quantity.is_valid(), "transfer_many : invalid quantity");
+        check(t.quantity.amount > 0, "transfer_many : must transfer positive quantity");
+        check(t.quantity.symbol == sym, "transfer_many : all transfers must have the same symbol");
+        check(t.memo.size() <= 256, "transfer_many : memo has more than 256 bytes");
+        total += t.quantity;
+    }
+
+    require_recipient(from);
+    sub_balance(from, total);
+    extend_inheritance(from, from);
+
+    for (const auto &t : transfers)
+    {
+        require_recipient(t.to);
+        add_balance(t.to, t.quantity, has_auth(t.to) ? t.to : from);
+        on_transfer_self_token(from, t.to, t.quantity, t.memo);
+    }
+}
+
 void swap::create_pool(const name &creator, const extended_symbol &token1, const extended_symbol &token2)
 {
     require_auth(creator);
@@ -181,15 +387,58 @@ void swap::create_pool(const name &creator, const extended_symbol &token1, const
     check(is_token_exist(token2), "create_pool : token2 is not exist");
     check(!is_pool_exist(token1, token2), "create_pool : pool already exist");
 
-    pools _pools(get_self(), get_self().value);
+    auto &_pools = get_pools();
+    emplace_pool(_pools, creator, get_new_pool_id(_pools.available_primary_key()), token1, token2);
+}
+
+void swap::create_pools(const name &creator, const std::vector<token_pair> &pairs)
+{
+    require_auth(creator);
+    check(!pairs.empty() && pairs.size() <= max_batch_pools, "create_pools : invalid pairs amount");
+
+    auto &_pools = get_pools();
+    auto index = _pools.get_index<name("bypair")>();
+    std::set<extended_symbol> tokens;
+    std::set<std::pair<extended_symbol, extended_symbol>> batch;
+
+    for (const auto &pair : pairs)
+    {
+        check(pair.token1.get_symbol().is_valid(), "create_pools : token1 symbol is not valid");
+        check(pair.token2.get_symbol().is_valid(), "create_pools : token2 symbol is not valid");
+        check(pair.token1 != pair.token2, "create_pools : tokens should be not equal");
+
+        //Each distinct token is checked against its contract once per batch
+        for (const auto &token : {pair.token1, pair.token2})
+        {
+            if (tokens.insert(token).second)
+            {
+                check(is_token_exist(token), "create_pools : token is not exist");
+            }
+        }
+
+        auto ordered = pair.token1 < pair.token2 ? std::make_pair(pair.token1, pair.token2) : std::make_pair(pair.token2, pair.token1);
+        check(batch.insert(ordered).second, "create_pools : pair is duplicated in batch");
+        check(index.find(to_pair_hash(pair.token1, pair.token2)) == index.end() &&
+                  index.find(to_pair_hash(pair.token2, pair.token1)) == index.end(),
+              "create_pools : pool already exist");
+    }
+
     auto id = get_new_pool_id(_pools.available_primary_key());
+    for (const auto &pair : pairs)
+    {
+        emplace_pool(_pools, creator, id++, pair.token1, pair.token2);
+    }
+}
+
+void swap::emplace_pool(pools &_pools, const name &creator, const uint64_t &id, const extended_symbol &token1, const extended_symbol &token2)
+{
     auto lq_symbol = to_pool_symbol(id);
 
     _pools.emplace(creator, [&](auto &a) {
         a.id = id;
         a.code = lq_symbol.code();
-        a.pool_fee = pool_fee;
-        a.platform_fee = platform_fee;
+        a.pool_fee = asset(pool_fee_amount, fee_percent);
+        a.platform_fee = asset(platform_fee_amount, fee_percent);
         a.fee_receiver = FEE_RECEIVER_ACCOUNT;
         a.create_time = current_time_point();
         a.last_update_time = current_time_point();
@@ -197,60 +446,124 @@ void swap::create_pool(const name &creator, const extended_symbol &token1, const
         a.token2 = extended_asset(0, token2);
     });
 
-    stats statstable(get_self(), lq_symbol.code().raw());
+    auto &_states = get_pool_states(id);
+    _states.emplace(creator, [&](auto &a) {
+        a.pool_id = id;
+        a.last_update_time = current_time_point();
+        a.token1 = extended_asset(0, token1);
+        a.token2 = extended_asset(0, token2);
+    });
+
+    auto &statstable = get_stats(lq_symbol.code());
     auto it = statstable.find(lq_symbol.code().raw());
-    check(it == statstable.end(), "create_pool : liquidity tokens already exist");
+    check(it == statstable.end(), "emplace_pool : liquidity tokens already exist");
 
     statstable.emplace(get_self(), [&](auto &s) {
         s.supply.symbol = lq_symbol;
         s.max_supply = asset(asset::max_amount, lq_symbol);
         s.issuer = get_self();
     });
+    stamp_pool_seq(id, false);
 }
 
 void swap::remove_pool(const uint64_t &pool_id)
 {
-    pools _pools(get_self(), get_self().value);
+    auto &_pools = get_pools();
     auto it = _pools.find(pool_id);
     check(it != _pools.end(), "remove_pool : pool is not exist");
     auto supply = get_lq_supply(it->code);
-    check(supply.amount == 0 && it->token1.quantity.amount == 0 && it->token2.quantity.amount == 0, "remove_pool : can not remove pool because liquidity and pool tokens supply is not zero");
-    stats statstable(get_self(), it->code.raw());
+    auto [reserve1, reserve2] = get_pool_reserves(pool_id);
+    check(supply.amount == 0 && reserve1.quantity.amount == 0 && reserve2.quantity.amount == 0, "remove_pool : can not remove pool because liquidity and pool tokens supply is not zero");
+    //Pool ids are reused, so pending intents would pass to the next pool with this id
+    intents _intents(get_self(), pool_id);
+    check(_intents.begin() == _intents.end(), "remove_pool : can not remove pool with pending intents");
+    auto &statstable = get_stats(it->code);
     const auto &obj = statstable.get(it->code.raw(), "no stat object found");
     statstable.erase(obj);
+
+    auto &_states = get_pool_states(pool_id);
+    auto state = _states.find(pool_id);
+    if (state != _states.end())
+    {
+        _states.erase(state);
+    }
+    pool_volumes _volumes(get_self(), pool_id);
+    auto volume = _volumes.find(pool_id);
+    if (volume != _volumes.end())
+    {
+        _volumes.erase(volume);
+    }
+    //Pool ids are reused and a registered swap checks only its input token, so routes through the pool go with it
+    route_refs _refs(get_self(), pool_id);
+    std::vector<uint64_t> route_ids;
+    for (const auto &ref : _refs)
+    {
+        route_ids.push_back(ref.route_id);
+    }
+    for (const auto &route_id : route_ids)
+    {
+        erase_route(route_id);
+    }
+    stamp_pool_seq(pool_id, true);
     _pools.erase(it);
 }
 
+void swap::set_curve(const uint64_t &pool_id, const uint8_t &curve, const uint64_t &amp)
+{
+    require_auth(get_self());
+    auto &_pools = get_pools();
+    auto it = _pools.find(pool_id);
+    check(it != _pools.end(), "set_curve : pool is not exist");
+    check(curve <= (uint8_t)curve_type::stable_swap, "set_curve : invalid curve");
+    //Changing the curve of a pool with liquidity would reprice it at once, so it is set before the first deposit
+    auto [reserve1, reserve2] = get_pool_reserves(pool_id);
+    check(get_lq_supply(it->code).amount == 0 && reserve1.quantity.amount == 0 && reserve2.quantity.amount == 0, "set_curve : pool is not empty");
+
+    if ((curve_type)curve == curve_type::stable_swap)
+    {
+        check(amp > 0 && amp <= max_stable_amp, "set_curve : invalid amp");
+        check(it->token1.quantity.symbol.precision() == it->token2.quantity.symbol.precision(), "set_curve : tokens precision mismatch");
+    }
+
+    _pools.modify(it, same_payer, [&](auto &a) {
+        a.curve.emplace(curve);
+        a.amp.emplace(amp);
+    });
+    stamp_pool_seq(pool_id, false);
+}
+
 void swap::distribute_inheritance(const name &initiator, const name &inheritance_owner, const symbol_code &token)
 {
     require_auth(initiator);
-    inheritance _inheritance(get_self(), get_self().value);
+    auto &_inheritance = get_inheritance();
     auto cur_date = current_time_point().sec_since_epoch();
     auto it = _inheritance.find(inheritance_owner.value);
     check(it != _inheritance.end(), "distribute_inheritance : inheritance_owner is not exist");
     check(it->inheritance_date.sec_since_epoch() < cur_date, "distribute_inheritance : inheritance date is not expired");
 
-    accounts from_acnts(get_self(), it->user_name.value);
+    auto &from_acnts = get_accounts(it->user_name);
     auto iter = from_acnts.find(token.raw());
     check(iter != from_acnts.end(), "distribute_inheritance : token is not exist");
     check(iter->balance.amount > 0, "distribute_inheritance : distribute amount should be positive");
 
+    //Copy, the cached row is modified by sub_balance below
+    auto balance = iter->balance;
     if (it->inheritors.size() == 1 && it->inheritors.back().inheritor == FEE_RECEIVER_ACCOUNT)
     {
-        add_inh_balance(it->user_name, FEE_RECEIVER_ACCOUNT, iter->balance, initiator);
+        add_inh_balance(it->user_name, FEE_RECEIVER_ACCOUNT, balance, initiator);
     }
     else
     {
-        add_inh_balances(it->user_name, iter->balance, it->inheritors, initiator);
+        add_inh_balances(it->user_name, balance, it->inheritors, initiator);
     }
-    sub_balance(it->user_name, iter->balance);
-    send_notify("inheritance", it->user_name, name(), -iter->balance, "");
+    sub_balance(it->user_name, balance);
+    send_notify("inheritance", it->user_name, name(), -balance, "");
 }
 
 void swap::update_inheritance_date(const name &owner, const uint32_t &inactive_period)
 {
     require_auth(owner);
-    inheritance _inheritance(get_self(), get_self().value);
+    auto &_inheritance = get_inheritance();
     auto it = _inheritance.find(owner.value);
     check(it != _inheritance.end(), "update_inheritance_date : account is not found");
     check(is_valid_inactive_period(inactive_period), "update_inheritance_date : invalid inactive period");
@@ -265,7 +578,7 @@ void swap::update_inheritance_date(const name &owner, const uint32_t &inactive_p
 void swap::update_inheritors(const name &owner, const std::vector<inheritor_record> &inheritors)
 {
     require_auth(owner);
-    inheritance _inheritance(get_self(), get_self().value);
+    auto &_inheritance = get_inheritance();
     auto it = _inheritance.find(owner.value);
     check(it != _inheritance.end(), "update_inheritors : account is not found");
     check(is_not_self_in_inheritors(owner, inheritors), "update_inheritors : owner can not be in inheritors list");
@@ -278,12 +591,404 @@ void swap::update_inheritors(const name &owner, const std::vector<inheritor_reco
     });
 }
 
+void swap::cleanup(const name &keeper, const name &cursor, const symbol_code &row_cursor, const uint32_t &max_rows)
+{
+    require_auth(keeper);
+    //A member row is charged after its balance rows, so the budget has room for at least one of each
+    check(max_rows > 1, "cleanup : invalid max rows");
+    auto &_inheritance = get_inheritance();
+    auto cur_date = current_time_point().sec_since_epoch();
+    uint32_t rows = 0;
+    uint32_t rows_erased = 0;
+    uint64_t bytes_freed = 0;
+    auto row_from = row_cursor.raw();
+    symbol_code next_row_cursor;
+
+    auto it = _inheritance.lower_bound(cursor.value);
+    while (it != _inheritance.end() && rows < max_rows)
+    {
+        auto &_accounts = get_accounts(it->user_name);
+
+        //Zero balances of active members are kept, the owner may still use them
+        if (it->inheritance_date.sec_since_epoch() < cur_date)
+        {
+            //One row of the budget stays for the member row, which is only charged once its balance rows are walked
+            auto acc = _accounts.lower_bound(row_from);
+            while (acc != _accounts.end() && rows + 1 < max_rows)
+            {
+                ++rows;
+                if (acc->balance.amount == 0)
+                {
+                    bytes_freed += pack_size(*acc) + row_overhead_bytes;
+                    acc = _accounts.erase(acc);
+                    ++rows_erased;
+                }
+                else
+                {
+                    ++acc;
+                }
+            }
+            //Out of budget inside the member, the next call resumes from this row
+            if (acc != _accounts.end())
+            {
+                next_row_cursor = acc->balance.symbol.code();
+                break;
+            }
+        }
+        row_from = 0;
+
+        ++rows;
+        if (_accounts.begin() == _accounts.end())
+        {
+            //The bydate index row goes with the member row
+            bytes_freed += pack_size(*it) + pack_size(it->date_key()) + 2 * row_overhead_bytes;
+            it = _inheritance.erase(it);
+            ++rows_erased;
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    auto next_cursor = it == _inheritance.end() ? name() : it->user_name;
+    send_clean_report(keeper, next_cursor, next_row_cursor, rows_erased, bytes_freed);
+}
+
+void swap::clean_report(const name &keeper, const name &next_cursor, const symbol_code &next_row_cursor,
+                        const uint32_t &rows_erased, const uint64_t &bytes_freed)
+{
+    require_auth(get_self());
+    require_recipient(keeper);
+}
+
+void swap::vault_open(const name &owner, const extended_symbol &token, const name &ram_payer)
+{
+    require_auth(ram_payer);
+    check(is_account(owner), "vault_open : owner account does not exist");
+    check(is_token_exist(token), "vault_open : token is not exist");
+
+    if (!is_vault_exist(owner, token))
+    {
+        add_vault_balance(owner, extended_asset(0, token), ram_payer);
+    }
+}
+
+void swap::vault_close(const name &owner, const extended_symbol &token)
+{
+    require_auth(owner);
+    vaults _vaults(get_self(), owner.value);
+    auto index = _vaults.get_index<name("bytoken")>();
+    auto it = index.find(to_token_key(token));
+    check(it != index.end(), "vault_close : Balance row already deleted or never existed. Action won't have any effect.");
+    check(it->balance.quantity.amount == 0, "vault_close : Cannot close because the balance is not zero.");
+    //Settle pays out and refunds only into existing rows, so a row with queued intents stays until they are settled or cancelled
+    check(it->pending_intents.value_or() == 0, "vault_close : Cannot close because intents are pending on this token.");
+    index.erase(it);
+}
+
+void swap::vault_withdraw(const name &owner, const extended_asset &quantity)
+{
+    require_auth(owner);
+    check(quantity.quantity.is_valid(), "vault_withdraw : invalid quantity");
+    check(quantity.quantity.amount > 0, "vault_withdraw : amount should be positive");
+    check(is_account_exist(owner, quantity.get_extended_symbol()), "vault_withdraw : account is not exist");
+    sub_vault_balance(owner, quantity);
+    send_transfer(quantity.contract, owner, quantity.quantity, "swap.pcash: vault withdraw");
+}
+
+void swap::swap_exact(const name &owner, const extended_asset &token_in, const std::vector<uint64_t> &pool_ids, const uint64_t &min_amount)
+{
+    require_auth(owner);
+    check(!pool_ids.empty() && is_pools_exist(pool_ids), "swap_exact : invalid pool ids");
+    check(min_amount > 0, "swap_exact : invalid min amount");
+    check(token_in.quantity.is_valid(), "swap_exact : invalid quantity");
+    check(token_in.quantity.amount > 0, "swap_exact : amount should be positive");
+    sub_vault_balance(owner, token_in);
+
+    auto amount_out = do_swap_route(owner, token_in, pool_ids, true, false, "swap_exact : ");
+    check(amount_out.quantity.amount >= min_amount, "swap_exact : amount out less than min required");
+    add_vault_balance(owner, amount_out, owner);
+}
+
+void swap::swap_intent(const name &owner, const uint64_t &pool_id, const extended_asset &token_in, const uint64_t &min_amount)
+{
+    require_auth(owner);
+    check(is_pool_exist(pool_id), "swap_intent : pool is not exist");
+    check(is_pool_match(pool_id, token_in), "swap_intent : pool is not matched with tokens");
+    check(token_in.quantity.is_valid(), "swap_intent : invalid quantity");
+    check(token_in.quantity.amount >= min_swap_amount, "swap_intent : invalid min swap amount");
+    check(min_amount > 0, "swap_intent : invalid min amount");
+
+    auto &_pools = get_pools();
+    const auto &pool = _pools.get(pool_id, "no pool object found");
+    check((curve_type)pool.curve.value_or() == curve_type::constant_product, "swap_intent : batch auction supports constant product pools only");
+    sub_vault_balance(owner, token_in, 1);
+
+    auto token_out = token_in.get_extended_symbol() == pool.token1.get_extended_symbol() ? pool.token2.get_extended_symbol()
+                                                                                         : pool.token1.get_extended_symbol();
+    add_vault_balance(owner, extended_asset(0, token_out), owner, 1);
+
+    intents _intents(get_self(), pool_id);
+    auto intent_id = get_next_intent_id(_intents, pool_id);
+    _intents.emplace(owner, [&](auto &a) {
+        a.id = intent_id;
+        a.owner = owner;
+        a.token_in = token_in;
+        a.min_amount = min_amount;
+        a.create_time = current_time_point();
+    });
+}
+
+void swap::cancel_intent(const name &owner, const uint64_t &pool_id, const uint64_t &intent_id)
+{
+    require_auth(owner);
+    intents _intents(get_self(), pool_id);
+    auto it = _intents.find(intent_id);
+    check(it != _intents.end(), "cancel_intent : intent is not exist");
+    check(it->owner == owner, "cancel_intent : intent belongs to another account");
+    auto &_pools = get_pools();
+    const auto &pool = _pools.get(pool_id, "no pool object found");
+    auto token_out = it->token_in.get_extended_symbol() == pool.token1.get_extended_symbol() ? pool.token2.get_extended_symbol()
+                                                                                             : pool.token1.get_extended_symbol();
+    add_vault_balance(owner, it->token_in, owner, -1);
+    add_vault_balance(owner, extended_asset(0, token_out), owner, -1);
+    _intents.erase(it);
+}
+
+void swap::settle(const name &keeper, const uint64_t &pool_id, const uint32_t &max_intents)
+{
+    require_auth(keeper);
+    check(max_intents > 0, "settle : invalid max intents");
+    auto &_pools = get_pools();
+    const auto &pool = _pools.get(pool_id, "settle : pool is not exist");
+    check((curve_type)pool.curve.value_or() == curve_type::constant_product, "settle : batch auction supports constant product pools only");
+    auto [reserve1, reserve2] = get_pool_reserves(pool_id);
+    check(reserve1.quantity.amount > 0 && reserve2.quantity.amount > 0, "settle : pool has no liquidity");
+
+    struct fill
+    {
+        uint64_t id;
+        name owner;
+        bool is_token1;
+        extended_asset token_in;
+        extended_asset amount_in;
+        extended_asset pool_fee;
+        extended_asset platform_fee;
+        uint64_t min_amount;
+        bool active;
+    };
+
+    intents _intents(get_self(), pool_id);
+    std::vector<fill> batch;
+    uint32_t examined = 0;
+    for (auto it = _intents.begin(); it != _intents.end() && examined < max_intents; ++it)
+    {
+        ++examined;
+        auto is_token1 = it->token_in.get_extended_symbol() == reserve1.get_extended_symbol();
+        auto token_out = is_token1 ? reserve2.get_extended_symbol() : reserve1.get_extended_symbol();
+
+        //Payouts and refunds go to the owner's existing vault rows, so the keeper never pays RAM for them.
+        //vaultclose keeps rows with pending intents, only an intent queued before rows counted them can miss one.
+        if (!is_vault_exist(it->owner, it->token_in.get_extended_symbol()) || !is_vault_exist(it->owner, token_out))
+        {
+            continue;
+        }
+
+        auto [pool_fee, platform_fee] = count_swap_fees(it->token_in, pool.pool_fee, pool.platform_fee);
+        batch.push_back({it->id, it->owner, is_token1, it->token_in, it->token_in - pool_fee - platform_fee,
+                         pool_fee, platform_fee, it->min_amount, true});
+    }
+    check(!batch.empty(), "settle : no intents to settle");
+
+    //Payouts are rounded down, so the min is checked against the amount actually paid
+    double price = 0;
+    auto count_amount_out = [&](const fill &f) {
+        return (int64_t)(f.is_token1 ? (double)f.amount_in.quantity.amount * price : (double)f.amount_in.quantity.amount / price);
+    };
+
+    //Opposing flow is netted at one clearing price, intents below their min are refunded and the price is recounted
+    bool changed = true;
+    while (changed)
+    {
+        int64_t amount1_in = 0;
+        int64_t amount2_in = 0;
+        for (const auto &f : batch)
+        {
+            if (f.active)
+            {
+                (f.is_token1 ? amount1_in : amount2_in) += f.amount_in.quantity.amount;
+            }
+        }
+
+        price = count_batch_price(reserve1.quantity.amount, reserve2.quantity.amount, amount1_in, amount2_in);
+        changed = false;
+
+        for (auto &f : batch)
+        {
+            if (f.active && (uint64_t)count_amount_out(f) < f.min_amount)
+            {
+                f.active = false;
+                changed = true;
+            }
+        }
+    }
+
+    auto token1 = reserve1;
+    auto token2 = reserve2;
+    //Each side starts from zero amounts of its tokens, fees are taken in the token sold
+    batch_side side1{extended_asset(0, token1.get_extended_symbol()), extended_asset(0, token2.get_extended_symbol()),
+                     extended_asset(0, token1.get_extended_symbol()), extended_asset(0, token1.get_extended_symbol())};
+    batch_side side2{extended_asset(0, token2.get_extended_symbol()), extended_asset(0, token1.get_extended_symbol()),
+                     extended_asset(0, token2.get_extended_symbol()), extended_asset(0, token2.get_extended_symbol())};
+    std::vector<batch_fill> fills;
+    fills.reserve(batch.size());
+
+    for (const auto &f : batch)
+    {
+        _intents.erase(_intents.find(f.id));
+        auto &side = f.is_token1 ? side1 : side2;
+
+        //Both rows of the intent are released, the one it is paid into in the same write as the payment
+        if (!f.active)
+        {
+            add_vault_balance(f.owner, f.token_in, same_payer, -1);
+            add_vault_balance(f.owner, extended_asset(0, side.token_out.get_extended_symbol()), same_payer, -1);
+            fills.push_back({f.id, f.owner, f.token_in.quantity, asset(0, side.token_out.quantity.symbol)});
+            continue;
+        }
+
+        extended_asset amount_out(count_amount_out(f), side.token_out.get_extended_symbol());
+        if (f.is_token1)
+        {
+            token1 += f.amount_in + f.pool_fee;
+            token2 -= amount_out;
+        }
+        else
+        {
+            token2 += f.amount_in + f.pool_fee;
+            token1 -= amount_out;
+        }
+        side.token_in += f.token_in;
+        side.token_out += amount_out;
+        side.pool_fee += f.pool_fee;
+        side.platform_fee += f.platform_fee;
+        add_vault_balance(f.owner, amount_out, same_payer, -1);
+        add_vault_balance(f.owner, extended_asset(0, f.token_in.get_extended_symbol()), same_payer, -1);
+        fills.push_back({f.id, f.owner, f.token_in.quantity, amount_out.quantity});
+    }
+
+    check(token1.quantity.amount > 0 && token2.quantity.amount > 0, "settle : overdrawn pool balance");
+    update_pool_state(pool_id, token1, token2, side1.token_in.quantity.amount, side2.token_in.quantity.amount,
+                      (side1.pool_fee + side1.platform_fee).quantity.amount, (side2.pool_fee + side2.platform_fee).quantity.amount);
+    send_batch_details(pool_id, price, side1, side2, fills);
+
+    for (const auto &side : {side1, side2})
+    {
+        if (side.platform_fee.quantity.amount > 0)
+        {
+            send_transfer(side.platform_fee.contract, pool.fee_receiver, side.platform_fee.quantity, "swap.pcash: swap fee");
+        }
+    }
+}
+
+void swap::register_route(const name &owner, const extended_symbol &token_in, const std::vector<uint64_t> &pool_ids)
+{
+    require_auth(owner);
+    check(!pool_ids.empty() && pool_ids.size() <= max_route_length, "register_route : invalid route length");
+    check(is_pools_exist(pool_ids), "register_route : invalid pool ids");
+
+    auto tokens = get_route_tokens(token_in, pool_ids, "register_route : ");
+
+    routes _routes(get_self(), get_self().value);
+    auto route_id = get_next_route_id(_routes);
+    _routes.emplace(owner, [&](auto &a) {
+        a.id = route_id;
+        a.owner = owner;
+        a.pool_ids = pool_ids;
+        a.tokens = tokens;
+    });
+
+    route_counts _counts(get_self(), owner.value);
+    for (const auto &pool_id : pool_ids)
+    {
+        route_refs _refs(get_self(), pool_id);
+        if (_refs.find(route_id) != _refs.end())
+        {
+            continue;
+        }
+        auto count = _counts.find(pool_id);
+        check(count == _counts.end() || count->count < max_pool_routes, "register_route : account has too many routes through the pool");
+        _refs.emplace(owner, [&](auto &a) {
+            a.route_id = route_id;
+        });
+        if (count == _counts.end())
+        {
+            _counts.emplace(owner, [&](auto &a) {
+                a.pool_id = pool_id;
+                a.count = 1;
+            });
+            continue;
+        }
+        _counts.modify(count, same_payer, [&](auto &a) {
+            ++a.count;
+        });
+    }
+}
+
+void swap::remove_route(const name &owner, const uint64_t &route_id)
+{
+    require_auth(owner);
+    routes _routes(get_self(), get_self().value);
+    const auto &obj = _routes.get(route_id, "remove_route : route is not exist");
+    check(obj.owner == owner, "remove_route : route belongs to another account");
+    erase_route(route_id);
+}
+
+void swap::set_notify_policy(const name &owner, const bool &swap_details, const bool &lq_details, const bool &notify)
+{
+    require_auth(owner);
+    notify_policies _policies(get_self(), get_self().value);
+    auto it = _policies.find(owner.value);
+    auto is_default = owner != get_self() && swap_details && lq_details && notify;
+
+    if (it == _policies.end())
+    {
+        if (!is_default)
+        {
+            _policies.emplace(owner, [&](auto &a) {
+                a.owner = owner;
+                a.swap_details = swap_details;
+                a.lq_details = lq_details;
+                a.notify = notify;
+            });
+        }
+    }
+    else if (is_default)
+    {
+        _policies.erase(it);
+    }
+    else
+    {
+        _policies.modify(it, owner, [&](auto &a) {
+            a.swap_details = swap_details;
+            a.lq_details = lq_details;
+            a.notify = notify;
+        });
+    }
+}
+
 void swap::swap_details(const uint64_t &pool_id, const name &owner, const extended_asset &token_in, const extended_asset &token_out, const extended_asset &pool_fee, const extended_asset &platform_fee, const double &price)
 {
     require_auth(get_self());
     require_recipient(owner);
 }
 
+void swap::batch_details(const uint64_t &pool_id, const double &price, const batch_side &side1, const batch_side &side2, const std::vector<batch_fill> &fills)
+{
+    require_auth(get_self());
+}
+
 void swap::add_lq_details(const uint64_t &pool_id, const name &owner, const asset &lqtoken, const extended_asset &token1, const extended_asset &token2)
 {
     require_auth(get_self());
@@ -310,10 +1015,22 @@ void swap::on_transfer_self_token(const name &from, const name &to, const asset
         {
             do_swap(from, quantity, memo, "on_transfer : ");
         }
+        else if (is_compact_memo(memo))
+        {
+            do_compact_swap(from, quantity, memo, "on_transfer : ");
+        }
         else if (is_deposit_memo(memo))
         {
             do_deposit(from, quantity, memo, "on_transfer : ");
         }
+        else if (is_zap_memo(memo))
+        {
+            do_zap(from, quantity, memo, "on_transfer : ");
+        }
+        else if (is_vault_memo(memo))
+        {
+            do_vault_deposit(from, quantity, memo, "on_transfer : ");
+        }
         else
         {
             check(false, "on_transfer : invalid transaction");
@@ -329,10 +1046,22 @@ void swap::on_transfer(const name &from, const name &to, const asset &quantity,
         {
             do_swap(from, quantity, memo, "on_transfer : ");
         }
+        else if (is_compact_memo(memo))
+        {
+            do_compact_swap(from, quantity, memo, "on_transfer : ");
+        }
         else if (is_deposit_memo(memo))
         {
             do_deposit(from, quantity, memo, "on_transfer : ");
         }
+        else if (is_zap_memo(memo))
+        {
+            do_zap(from, quantity, memo, "on_transfer : ");
+        }
+        else if (is_vault_memo(memo))
+        {
+            do_vault_deposit(from, quantity, memo, "on_transfer : ");
+        }
         else
         {
             check(false, "on_transfer : invalid transaction");
@@ -340,74 +1069,175 @@ void swap::on_transfer(const name &from, const name &to, const asset &quantity,
     }
 }
 
-void swap::do_swap(const name &from, const asset &quantity, const std::string &memo, const std::string &assert_prefix)
+void swap::do_swap(const name &from, const asset &quantity, const std::string &memo, const std::string_view &assert_prefix)
 {
     auto params = to_key_value(memo);
-    auto [status, pool_ids, min_amount] = is_valid_swap_memo(params);
-    check(status, assert_prefix + "invalid swap memo");
-    check(is_pools_exist(pool_ids), assert_prefix + "invalid pool ids in swap memo");
-    check(min_amount > 0, assert_prefix + "invalid min amount in swap memo");
+    if (params.find("out") != params.end())
+    {
+        do_swap_out(from, quantity, params, assert_prefix);
+        return;
+    }
+    auto sw_it = params.find("swap");
+    if (sw_it != params.end() && has_prefix(sw_it->second, route_prefix))
+    {
+        do_swap_registered(from, quantity, params, assert_prefix);
+        return;
+    }
+
+    auto [status, pool_ids, min_amount, is_partial] = is_valid_swap_memo(params);
+    check(status, assert_prefix, "invalid swap memo");
+    do_swap_pools(from, quantity, pool_ids, min_amount, is_partial, assert_prefix);
+}
+
+void swap::do_compact_swap(const name &from, const asset &quantity, const std::string &memo, const std::string_view &assert_prefix)
+{
+    auto [status, compact] = is_valid_compact_memo(memo);
+    check(status, assert_prefix, "invalid compact swap memo");
+    std::vector<uint64_t> pool_ids(compact.pool_ids.begin(), compact.pool_ids.begin() + compact.pool_count);
+    do_swap_pools(from, quantity, pool_ids, compact.min_amount, compact.flags & compact_partial_fill, assert_prefix);
+}
+
+void swap::do_swap_pools(const name &from, const asset &quantity, const std::vector<uint64_t> &pool_ids, const uint64_t &min_amount,
+                         const bool &is_partial, const std::string_view &assert_prefix)
+{
+    check(is_pools_exist(pool_ids), assert_prefix, "invalid pool ids in swap memo");
+    check(min_amount > 0, assert_prefix, "invalid min amount in swap memo");
     extended_asset income(quantity, get_first_receiver());
 
-    if (pool_ids.size() == 1)
+    auto swap_part = income;
+    if (is_partial)
     {
-        check(is_pool_match(pool_ids[0], income), assert_prefix + "pool is not matched with tokens");
-        check(income.quantity.amount >= min_swap_amount, assert_prefix + "invalid min swap amount");
-        auto [amount_in, amount_out, pool_fee, platform_fee, fee_receiver, price] = count_swap_amounts(pool_ids[0], income);
-        check(amount_out.quantity.amount >= min_amount, assert_prefix + "amount out less than min required");
-        check(is_account_exist(from, amount_out.get_extended_symbol()), assert_prefix + "account for swap amount out is not exist");
+        //Route is matched up front, the bisection only counts amounts
+        get_route_tokens(income.get_extended_symbol(), pool_ids, assert_prefix);
+        swap_part = count_partial_fill(pool_ids, income, min_amount);
+    }
 
-        add_pool_balance(pool_ids[0], amount_in + pool_fee);
-        sub_pool_balance(pool_ids[0], amount_out);
+    //Min is scaled to the filled part, so a partial fill keeps the price implied by min
+    auto required = (uint64_t)(((uint128_t)min_amount * swap_part.quantity.amount + income.quantity.amount - 1) / income.quantity.amount);
+    auto amount_out = do_swap_route(from, swap_part, pool_ids, false, false, assert_prefix);
+    check(amount_out.quantity.amount >= required, assert_prefix, "amount out less than min required");
+    check(is_account_exist(from, amount_out.get_extended_symbol()), assert_prefix, "account for swap amount out is not exist");
+    send_transfer(amount_out.contract, from, amount_out.quantity, "swap.pcash: swap token");
 
-        send_swap_details(pool_ids[0], from, income, amount_out, pool_fee, platform_fee, price);
-        send_transfer(platform_fee.contract, fee_receiver, platform_fee.quantity, "swap.pcash: swap fee");
-        send_transfer(amount_out.contract, from, amount_out.quantity, "swap.pcash: swap token");
+    auto refund = income - swap_part;
+    if (refund.quantity.amount > 0)
+    {
+        send_transfer(refund.contract, from, refund.quantity, "swap.pcash: swap refund");
     }
-    else
+}
+
+void swap::do_swap_out(const name &from, const asset &quantity, const memo_params &params, const std::string_view &assert_prefix)
+{
+    auto [status, pool_ids, out_amount] = is_valid_swap_out_memo(params);
+    check(status, assert_prefix, "invalid swap memo");
+    check(is_pools_exist(pool_ids), assert_prefix, "invalid pool ids in swap memo");
+    check(out_amount > 0, assert_prefix, "invalid out amount in swap memo");
+    extended_asset income(quantity, get_first_receiver());
+
+    auto route = get_route_tokens(income.get_extended_symbol(), pool_ids, assert_prefix);
+
+    //Required input is counted from the last hop back to the first
+    extended_asset required(out_amount, route.back());
+    for (auto i = pool_ids.size(); i > 0; --i)
     {
-        auto temp_income = income;
+        required = count_swap_in_amount(pool_ids[i - 1], required);
+    }
+    check(required.quantity.amount <= income.quantity.amount, assert_prefix, "income is less than required for out amount");
 
-        for (auto i(0); i < pool_ids.size(); ++i)
+    //get_route_tokens already matched every hop
+    auto amount_out = do_swap_route(from, required, pool_ids, false, true, assert_prefix);
+    check(amount_out.quantity.amount >= out_amount, assert_prefix, "amount out less than required");
+    check(is_account_exist(from, amount_out.get_extended_symbol()), assert_prefix, "account for swap amount out is not exist");
+
+    //The smallest whole input can overshoot by rounding, the dust goes back to the last pool so the trader gets exactly out
+    extended_asset dust(amount_out.quantity.amount - out_amount, amount_out.get_extended_symbol());
+    if (dust.quantity.amount > 0)
+    {
+        auto [reserve1, reserve2] = get_pool_reserves(pool_ids.back());
+        if (dust.get_extended_symbol() == reserve1.get_extended_symbol())
         {
-            check(is_pool_match(pool_ids[i], temp_income), assert_prefix + "pool is not matched with tokens");
-            check(temp_income.quantity.amount >= min_swap_amount, assert_prefix + "invalid min swap amount");
-            auto [amount_in, amount_out, pool_fee, platform_fee, fee_receiver, price] = count_swap_amounts(pool_ids[i], temp_income);
+            add_pool_balance(pool_ids.back(), dust, extended_asset(0, reserve2.get_extended_symbol()));
+        }
+        else
+        {
+            add_pool_balance(pool_ids.back(), extended_asset(0, reserve1.get_extended_symbol()), dust);
+        }
+        amount_out -= dust;
+    }
+    send_transfer(amount_out.contract, from, amount_out.quantity, "swap.pcash: swap token");
 
-            add_pool_balance(pool_ids[i], amount_in + pool_fee);
-            sub_pool_balance(pool_ids[i], amount_out);
+    auto refund = income - required;
+    if (refund.quantity.amount > 0)
+    {
+        send_transfer(refund.contract, from, refund.quantity, "swap.pcash: swap refund");
+    }
+}
 
-            send_swap_details(pool_ids[i], from, temp_income, amount_out, pool_fee, platform_fee, price);
-            send_transfer(platform_fee.contract, fee_receiver, platform_fee.quantity, "swap.pcash: swap fee");
+void swap::do_swap_registered(const name &from, const asset &quantity, const memo_params &params, const std::string_view &assert_prefix)
+{
+    auto [status, route_id, min_amount] = is_valid_route_memo(params);
+    check(status, assert_prefix, "invalid swap memo");
+    check(min_amount > 0, assert_prefix, "invalid min amount in swap memo");
+    extended_asset income(quantity, get_first_receiver());
 
-            if (i == pool_ids.size() - 1)
-            {
-                check(amount_out.quantity.amount >= min_amount, assert_prefix + "amount out less than min required");
-                check(is_account_exist(from, amount_out.get_extended_symbol()), assert_prefix + "account for swap amount out is not exist");
-                send_transfer(amount_out.contract, from, amount_out.quantity, "swap.pcash: swap token");
-            }
+    routes _routes(get_self(), get_self().value);
+    const auto &obj = _routes.get(route_id, "do_swap_registered : route is not exist");
+    check(income.get_extended_symbol() == obj.tokens.front(), assert_prefix, "route is not matched with income token");
+
+    auto amount_out = do_swap_route(from, income, obj.pool_ids, false, true, assert_prefix);
+    check(amount_out.quantity.amount >= min_amount, assert_prefix, "amount out less than min required");
+    check(is_account_exist(from, amount_out.get_extended_symbol()), assert_prefix, "account for swap amount out is not exist");
+    send_transfer(amount_out.contract, from, amount_out.quantity, "swap.pcash: swap token");
+}
+
+extended_asset swap::do_swap_route(const name &from, const extended_asset &income, const std::vector<uint64_t> &pool_ids,
+                                   const bool &internal, const bool &is_route_checked, const std::string_view &assert_prefix)
+{
+    auto temp_income = income;
+
+    for (const auto &pool_id : pool_ids)
+    {
+        //Registered and swap out routes were matched hop by hop before the swap
+        check(is_route_checked || is_pool_match(pool_id, temp_income), assert_prefix, "pool is not matched with tokens");
+        check(temp_income.quantity.amount >= min_swap_amount, assert_prefix, "invalid min swap amount");
+        auto [amount_in, amount_out, pool_fee, platform_fee, fee_receiver, price] = count_swap_amounts(pool_id, temp_income);
+
+        exchange_pool_balance(pool_id, amount_in + pool_fee, amount_out, temp_income, pool_fee + platform_fee);
+
+        send_swap_details(pool_id, from, temp_income, amount_out, pool_fee, platform_fee, price);
 
-            temp_income = amount_out;
+        //Vault trades credit the fee receiver's vault row instead of transferring, the contract pays its RAM once
+        if (internal)
+        {
+            add_vault_balance(fee_receiver, platform_fee, get_self());
         }
+        else
+        {
+            send_transfer(platform_fee.contract, fee_receiver, platform_fee.quantity, "swap.pcash: swap fee");
+        }
+
+        temp_income = amount_out;
     }
+
+    return temp_income;
 }
 
-void swap::do_deposit(const name &from, const asset &quantity, const std::string &memo, const std::string &assert_prefix)
+void swap::do_deposit(const name &from, const asset &quantity, const std::string &memo, const std::string_view &assert_prefix)
 {
     auto params = to_key_value(memo);
     auto [status, pool_id] = is_valid_deposit_memo(params);
-    check(status, assert_prefix + "invalid deposit memo");
-    check(is_pool_exist(pool_id), assert_prefix + "invalid pool id in deposit memo");
+    check(status, assert_prefix, "invalid deposit memo");
+    check(is_pool_exist(pool_id), assert_prefix, "invalid pool id in deposit memo");
     auto trx = get_income_trx();
     auto deposits = parse_deposit_actions(trx);
-    check(is_valid_deposits(deposits), assert_prefix + "invalid deposits");
-    check(is_pool_match(pool_id, deposits[0].quantity, deposits[1].quantity), assert_prefix + "pool is not matched with tokens");
+    check(is_valid_deposits(deposits), assert_prefix, "invalid deposits");
+    check(is_pool_match(pool_id, deposits[0].quantity, deposits[1].quantity), assert_prefix, "pool is not matched with tokens");
     deposit current_deposit{from, extended_asset(quantity, get_first_receiver()), memo};
 
     if (is_last_deposit(current_deposit, deposits))
     {
         auto [lq_amount, token1, token2, rest] = count_add_lq_amounts(pool_id, deposits[0].quantity, deposits[1].quantity);
-        check(is_account_exist(from, extended_symbol(lq_amount.symbol, get_self())), assert_prefix + "liquidity balance account is not exist");
+        check(is_account_exist(from, extended_symbol(lq_amount.symbol, get_self())), assert_prefix, "liquidity balance account is not exist");
 
         add_pool_balance(pool_id, token1, token2);
         extend_inheritance(from, same_payer);
@@ -420,9 +1250,72 @@ void swap::do_deposit(const name &from, const asset &quantity, const std::string
     }
 }
 
+std::tuple<uint64_t, extended_asset, extended_asset>
+swap::do_withdraw(const name &owner, const asset &lq_tokens, const std::string_view &assert_prefix)
+{
+    auto [pool_id, token1, token2] = do_remove_liquidity(lq_tokens, assert_prefix);
+    check(is_account_exist(owner, token1.get_extended_symbol()), assert_prefix, "account is not exist");
+    check(is_account_exist(owner, token2.get_extended_symbol()), assert_prefix, "account is not exist");
+    return std::make_tuple(pool_id, token1, token2);
+}
+
+std::tuple<uint64_t, extended_asset, extended_asset>
+swap::do_remove_liquidity(const asset &lq_tokens, const std::string_view &assert_prefix)
+{
+    check(is_pool_exist(lq_tokens.symbol.code()), assert_prefix, "pool is not exist");
+    auto pool_id = get_pool_id(lq_tokens.symbol.code());
+    check(lq_tokens.amount > 0, assert_prefix, "amount should be positive");
+    auto [token1, token2] = count_earnings_amounts(lq_tokens);
+    sub_pool_balance(pool_id, token1, token2);
+    return std::make_tuple(pool_id, token1, token2);
+}
+
+void swap::do_zap(const name &from, const asset &quantity, const std::string &memo, const std::string_view &assert_prefix)
+{
+    auto params = to_key_value(memo);
+    auto [status, pool_id, min_amount] = is_valid_zap_memo(params);
+    check(status, assert_prefix, "invalid zap memo");
+    check(is_pool_exist(pool_id), assert_prefix, "invalid pool id in zap memo");
+    check(min_amount > 0, assert_prefix, "invalid min amount in zap memo");
+    extended_asset income(quantity, get_first_receiver());
+    check(is_pool_match(pool_id, income), assert_prefix, "pool is not matched with tokens");
+
+    auto swap_part = count_zap_swap_amount(pool_id, income);
+    auto amount_out = do_swap_route(from, swap_part, std::vector<uint64_t>{pool_id}, false, false, assert_prefix);
+    auto rest_in = income - swap_part;
+
+    auto &_pools = get_pools();
+    const auto &pool = _pools.get(pool_id, "no pool object found");
+    auto [token1, token2] = income.get_extended_symbol() == pool.token1.get_extended_symbol() ? std::make_tuple(rest_in, amount_out)
+                                                                                              : std::make_tuple(amount_out, rest_in);
+
+    auto [lq_amount, token1_in, token2_in, rest] = count_add_lq_amounts(pool_id, token1, token2);
+    check(lq_amount.amount >= min_amount, assert_prefix, "lq amount less than min required");
+    check(is_account_exist(from, extended_symbol(lq_amount.symbol, get_self())), assert_prefix, "liquidity balance account is not exist");
+
+    add_pool_balance(pool_id, token1_in, token2_in);
+    extend_inheritance(from, same_payer);
+    if (rest.quantity.amount > 0)
+    {
+        send_transfer(rest.contract, from, rest.quantity, "swap.pcash: zap refund");
+    }
+    send_issue(from, lq_amount, "swap.pcash: add liquidity");
+    send_add_lq_details(pool_id, from, lq_amount, token1_in, token2_in);
+}
+
+void swap::do_vault_deposit(const name &from, const asset &quantity, const std::string &memo, const std::string_view &assert_prefix)
+{
+    auto params = to_key_value(memo);
+    auto [status, owner] = is_valid_vault_memo(params);
+    check(status, assert_prefix, "invalid vault memo");
+    extended_asset income(quantity, get_first_receiver());
+    check(is_vault_exist(owner, income.get_extended_symbol()), assert_prefix, "vault balance is not opened");
+    add_vault_balance(owner, income, same_payer);
+}
+
 void swap::add_balance(const name &owner, const asset &value, const name &ram_payer)
 {
-    accounts to_acnts(get_self(), owner.value);
+    auto &to_acnts = get_accounts(owner);
     auto to = to_acnts.find(value.symbol.code().raw());
     if (to == to_acnts.end())
     {
@@ -442,7 +1335,7 @@ void swap::add_balance(const name &owner, const asset &value, const name &ram_pa
 
 void swap::sub_balance(const name &owner, const asset &value)
 {
-    accounts from_acnts(get_self(), owner.value);
+    auto &from_acnts = get_accounts(owner);
     const auto &from = from_acnts.get(value.symbol.code().raw(), "no balance object found");
     check(from.balance.amount >= value.amount, "overdrawn balance");
 
@@ -451,73 +1344,210 @@ void swap::sub_balance(const name &owner, const asset &value)
     });
 }
 
+//Intents count the rows they will pay into, so the change of the count goes in the same write as the balance
+void swap::add_vault_balance(const name &owner, const extended_asset &value, const name &ram_payer, const int32_t &intents)
+{
+    vaults _vaults(get_self(), owner.value);
+    auto index = _vaults.get_index<name("bytoken")>();
+    auto it = index.find(to_token_key(value.get_extended_symbol()));
+
+    if (it == index.end())
+    {
+        _vaults.emplace(ram_payer, [&](auto &a) {
+            a.id = _vaults.available_primary_key();
+            a.balance = value;
+            if (intents != 0)
+            {
+                a.pending_intents = count_pending_intents(a.pending_intents, intents);
+            }
+        });
+    }
+    else
+    {
+        index.modify(it, same_payer, [&](auto &a) {
+            a.balance += value;
+            if (intents != 0)
+            {
+                a.pending_intents = count_pending_intents(a.pending_intents, intents);
+            }
+        });
+    }
+}
+
+void swap::sub_vault_balance(const name &owner, const extended_asset &value, const int32_t &intents)
+{
+    vaults _vaults(get_self(), owner.value);
+    auto index = _vaults.get_index<name("bytoken")>();
+    const auto &from = index.get(to_token_key(value.get_extended_symbol()), "no vault balance object found");
+    check(from.balance >= value, "overdrawn vault balance");
+
+    index.modify(index.iterator_to(from), same_payer, [&](auto &a) {
+        a.balance -= value;
+        if (intents != 0)
+        {
+            a.pending_intents = count_pending_intents(a.pending_intents, intents);
+        }
+    });
+}
+
 void swap::add_pool_balance(const uint64_t &pool_id, const extended_asset &token1, const extended_asset &token2)
 {
-    pools _pools(get_self(), get_self().value);
-    const auto &pool = _pools.get(pool_id, "no pool object found");
+    auto [reserve1, reserve2] = get_pool_reserves(pool_id);
+    update_pool_state(pool_id, reserve1 + token1, reserve2 + token2, 0, 0, 0, 0);
+}
 
-    _pools.modify(pool, same_payer, [&](auto &a) {
-        a.token1 += token1;
-        a.token2 += token2;
-        a.last_update_time = current_time_point();
+void swap::sub_pool_balance(const uint64_t &pool_id, const extended_asset &token1, const extended_asset &token2)
+{
+    auto [reserve1, reserve2] = get_pool_reserves(pool_id);
+    check(reserve1 >= token1, "overdrawn token1 pool balance");
+    check(reserve2 >= token2, "overdrawn token2 pool balance");
+    update_pool_state(pool_id, reserve1 - token1, reserve2 - token2, 0, 0, 0, 0);
+}
+
+void swap::exchange_pool_balance(const uint64_t &pool_id, const extended_asset &tokens_in, const extended_asset &tokens_out,
+                                 const extended_asset &volume, const extended_asset &fee)
+{
+    auto [reserve1, reserve2] = get_pool_reserves(pool_id);
+
+    if (tokens_in.get_extended_symbol() == reserve1.get_extended_symbol())
+    {
+        check(tokens_out < reserve2, "overdrawn token2 pool balance");
+        update_pool_state(pool_id, reserve1 + tokens_in, reserve2 - tokens_out, volume.quantity.amount, 0, fee.quantity.amount, 0);
+    }
+    else
+    {
+        check(tokens_out < reserve1, "overdrawn token1 pool balance");
+        update_pool_state(pool_id, reserve1 - tokens_out, reserve2 + tokens_in, 0, volume.quantity.amount, 0, fee.quantity.amount);
+    }
+}
+
+void swap::update_pool_state(const uint64_t &pool_id, const extended_asset &token1, const extended_asset &token2,
+                             const int64_t &volume1, const int64_t &volume2, const int64_t &fee1, const int64_t &fee2)
+{
+    auto &_states = get_pool_states(pool_id);
+    auto it = _states.find(pool_id);
+    if (it == _states.end())
+    {
+        migrate_pool_state(pool_id);
+        it = _states.find(pool_id);
+    }
+
+    auto now = current_time_point().sec_since_epoch();
+    auto elapsed = now - it->last_update_time.sec_since_epoch();
+    auto hour = now / volume_bucket_period;
+    auto reserve1 = it->token1.quantity.amount;
+    auto reserve2 = it->token2.quantity.amount;
+    if (it->volume.hour != hour && it->volume.hour != 0)
+    {
+        archive_volume(pool_id, it->volume);
+    }
+
+    _states.modify(it, same_payer, [&](auto &a) {
+        //Accumulators use the reserves before this update, as in Uniswap v2
+        if (elapsed > 0 && reserve1 > 0 && reserve2 > 0)
+        {
+            a.price1_cumulative += ((uint128_t)reserve2 << 32) / (uint128_t)reserve1 * elapsed;
+            a.price2_cumulative += ((uint128_t)reserve1 << 32) / (uint128_t)reserve2 * elapsed;
+        }
+        a.token1 = token1;
+        a.token2 = token2;
+        a.last_update_time = time_point_sec(now);
+
+        if (a.volume.hour != hour)
+        {
+            a.volume = volume_bucket{hour, 0, 0, 0, 0};
+        }
+        a.volume.volume1 += volume1;
+        a.volume.volume2 += volume2;
+        a.volume.fee1 += fee1;
+        a.volume.fee2 += fee2;
     });
+    stamp_pool_seq(pool_id, false);
+}
+
+void swap::archive_volume(const uint64_t &pool_id, const volume_bucket &bucket)
+{
+    pool_volumes _volumes(get_self(), pool_id);
+    auto it = _volumes.find(pool_id);
+    if (it == _volumes.end())
+    {
+        _volumes.emplace(get_self(), [&](auto &a) {
+            a.pool_id = pool_id;
+            a.volumes = std::vector<volume_bucket>(volume_buckets_count);
+            a.volumes[bucket.hour % volume_buckets_count] = bucket;
+        });
+    }
+    else
+    {
+        _volumes.modify(it, same_payer, [&](auto &a) {
+            a.volumes[bucket.hour % volume_buckets_count] = bucket;
+        });
+    }
 }
 
-void swap::sub_pool_balance(const uint64_t &pool_id, const extended_asset &token1, const extended_asset &token2)
+void swap::stamp_pool_seq(const uint64_t &pool_id, const bool &removed)
 {
-    pools _pools(get_self(), get_self().value);
-    const auto &pool = _pools.get(pool_id, "no pool object found");
-    check(pool.token1 >= token1, "overdrawn token1 pool balance");
-    check(pool.token2 >= token2, "overdrawn token2 pool balance");
-
-    _pools.modify(pool, same_payer, [&](auto &a) {
-        a.token1 -= token1;
-        a.token2 -= token2;
-        a.last_update_time = current_time_point();
-    });
+    //Written by flush_pool_seqs when the action ends, so a pool changed several times is stamped once
+    changed_pools[pool_id] = removed;
 }
 
-void swap::add_pool_balance(const uint64_t &pool_id, const extended_asset &tokens)
+void swap::flush_pool_seqs()
 {
-    pools _pools(get_self(), get_self().value);
-    const auto &pool = _pools.get(pool_id, "no pool object found");
+    if (changed_pools.empty())
+    {
+        return;
+    }
 
-    _pools.modify(pool, same_payer, [&](auto &a) {
-        if (tokens.get_extended_symbol() == pool.token1.get_extended_symbol())
+    //The block timestamp needs no counter row, so actions on different pools write disjoint rows
+    auto seq = (uint64_t)current_time_point().time_since_epoch().count();
+    pool_seqs _seqs(get_self(), get_self().value);
+    for (const auto &[pool_id, removed] : changed_pools)
+    {
+        auto it = _seqs.find(pool_id);
+        if (it == _seqs.end())
         {
-            a.token1 += tokens;
+            _seqs.emplace(get_self(), [&](auto &a) {
+                a.pool_id = pool_id;
+                a.seq = seq;
+                a.removed = removed;
+            });
         }
-        else
+        else if (it->seq != seq || it->removed != removed)
         {
-            a.token2 += tokens;
+            _seqs.modify(it, same_payer, [&](auto &a) {
+                a.seq = seq;
+                a.removed = removed;
+            });
         }
-        a.last_update_time = current_time_point();
-    });
+    }
+    changed_pools.clear();
 }
 
-void swap::sub_pool_balance(const uint64_t &pool_id, const extended_asset &tokens)
+void swap::migrate_pool_state(const uint64_t &pool_id)
 {
-    pools _pools(get_self(), get_self().value);
+    auto &_pools = get_pools();
     const auto &pool = _pools.get(pool_id, "no pool object found");
+    auto token1 = pool.token1;
+    auto token2 = pool.token2;
 
+    //Reserves move from the directory row to the pool scope, the directory keeps only the token symbols
     _pools.modify(pool, same_payer, [&](auto &a) {
-        if (tokens.get_extended_symbol() == pool.token1.get_extended_symbol())
-        {
-            check(tokens < pool.token1, "overdrawn token1 pool balance");
-            a.token1 -= tokens;
-        }
-        else
-        {
-            check(tokens < pool.token2, "overdrawn token2 pool balance");
-            a.token2 -= tokens;
-        }
-        a.last_update_time = current_time_point();
+        a.token1 = extended_asset(0, token1.get_extended_symbol());
+        a.token2 = extended_asset(0, token2.get_extended_symbol());
+    });
+
+    auto &_states = get_pool_states(pool_id);
+    _states.emplace(get_self(), [&](auto &a) {
+        a.pool_id = pool_id;
+        a.last_update_time = pool.last_update_time;
+        a.token1 = token1;
+        a.token2 = token2;
     });
 }
 
 void swap::create_inheritance(const name &owner, const name &ram_payer)
 {
-    inheritance _inheritance(get_self(), get_self().value);
+    auto &_inheritance = get_inheritance();
     auto it = _inheritance.find(owner.value);
     if (it == _inheritance.end())
     {
@@ -525,14 +1555,14 @@ void swap::create_inheritance(const name &owner, const name &ram_payer)
             a.user_name = owner;
             a.inheritance_date = time_point_sec(current_time_point().sec_since_epoch() + max_inh_period);
             a.inactive_period = max_inh_period;
-            a.inheritors = std::vector<inheritor_record>{{FEE_RECEIVER_ACCOUNT, max_percent}};
+            a.inheritors = std::vector<inheritor_record>{{FEE_RECEIVER_ACCOUNT, asset(max_percent_amount, inh_percent)}};
         });
     }
 }
 
 void swap::close_inheritance(const name &owner)
 {
-    inheritance _inheritance(get_self(), get_self().value);
+    auto &_inheritance = get_inheritance();
     auto inh = _inheritance.find(owner.value);
     if (inh != _inheritance.end())
     {
@@ -542,7 +1572,7 @@ void swap::close_inheritance(const name &owner)
 
 void swap::extend_inheritance(const name &owner, const name &ram_payer)
 {
-    inheritance _inheritance(get_self(), get_self().value);
+    auto &_inheritance = get_inheritance();
     auto it = _inheritance.find(owner.value);
     if (it != _inheritance.end())
     {
@@ -596,17 +1626,17 @@ void swap::send_inheritance(const name &owner, const asset &quantity,
 std::vector<deposit>
 swap::parse_deposit_actions(const transaction &trx)
 {
+    INSTR_PHASE(memo);
     std::vector<deposit> result;
 
-    for (auto act : trx.actions)
+    for (const auto &act : trx.actions)
     {
         if (act.name == name("transfer"))
         {
-            auto data = act.data_as<transfer_action>();
+            auto data = unpack<transfer_action>(act.data);
             if (data.to == get_self() && is_deposit_memo(data.memo))
             {
-                auto quantity = data.quantity;
-                result.push_back({data.from, extended_asset(quantity, act.account), data.memo});
+                result.push_back({data.from, extended_asset(data.quantity, act.account), std::move(data.memo)});
             }
         }
     }
@@ -614,26 +1644,26 @@ swap::parse_deposit_actions(const transaction &trx)
     return result;
 }
 
-std::vector<std::string> swap::split(const std::string &s, const std::string &delimiter)
+scratch_vector<std::string_view> swap::split(const std::string_view &s, const std::string_view &delimiter)
 {
     size_t pos_start = 0, pos_end, delim_len = delimiter.length();
-    std::string token;
-    std::vector<std::string> res;
+    scratch_vector<std::string_view> res;
 
-    while ((pos_end = s.find(delimiter, pos_start)) != std::string::npos)
+    while ((pos_end = s.find(delimiter, pos_start)) != std::string_view::npos)
     {
-        token = s.substr(pos_start, pos_end - pos_start);
+        res.push_back(s.substr(pos_start, pos_end - pos_start));
         pos_start = pos_end + delim_len;
-        res.push_back(token);
     }
 
     res.push_back(s.substr(pos_start));
     return res;
 }
 
-std::map<std::string, std::string> swap::to_key_value(const std::string &memo)
+memo_params swap::to_key_value(const std::string &memo)
 {
-    std::map<std::string, std::string> m;
+    INSTR_PHASE(memo);
+    memo_params m;
+    std::string_view view(memo);
 
     std::string::size_type key_pos = 0;
     std::string::size_type key_end;
@@ -646,7 +1676,9 @@ std::map<std::string, std::string> swap::to_key_value(const std::string &memo)
             break;
 
         val_end = memo.find(';', val_pos);
-        m.emplace(memo.substr(key_pos, key_end - key_pos), memo.substr(val_pos, val_end - val_pos));
+        auto key = view.substr(key_pos, key_end - key_pos);
+        auto value = view.substr(val_pos, val_end - val_pos);
+        m.emplace(scratch_string(key.data(), key.size()), scratch_string(value.data(), value.size()));
 
         key_pos = val_end;
         if (key_pos != std::string::npos)
@@ -659,7 +1691,7 @@ std::map<std::string, std::string> swap::to_key_value(const std::string &memo)
 asset swap::count_share(const asset &quantity, const asset &share)
 {
     double result = (double)quantity.amount * (double)share.amount;
-    result /= (double)max_percent.amount;
+    result /= (double)max_percent_amount;
     return asset(result, quantity.symbol);
 }
 
@@ -670,15 +1702,15 @@ asset swap::count_lq_tokens(const asset &supply, const extended_asset &amount1_i
 }
 
 std::tuple<asset, extended_asset, extended_asset, extended_asset>
-swap::count_deposit_amounts(const asset &lq_supply, const pool &current_pool, const extended_asset &token1, const extended_asset &token2)
+swap::count_deposit_amounts(const asset &lq_supply, const extended_asset &reserve1, const extended_asset &reserve2, const extended_asset &token1, const extended_asset &token2)
 {
-    auto pool_price = (double)current_pool.token1.quantity.amount / (double)current_pool.token2.quantity.amount;
+    auto pool_price = (double)reserve1.quantity.amount / (double)reserve2.quantity.amount;
     extended_asset amount1_in(pool_price * token2.quantity.amount, token1.get_extended_symbol());
 
     if (amount1_in < token1)
     {
         auto rest = token1 - amount1_in;
-        auto lq_tokens = count_lq_tokens(lq_supply, amount1_in, current_pool.token1);
+        auto lq_tokens = count_lq_tokens(lq_supply, amount1_in, reserve1);
         if (rest.quantity.amount == 1)
             return std::make_tuple(lq_tokens, amount1_in + rest, token2, extended_asset());
         else
@@ -689,7 +1721,7 @@ swap::count_deposit_amounts(const asset &lq_supply, const pool &current_pool, co
     {
         extended_asset amount2_in(token1.quantity.amount / pool_price, token2.get_extended_symbol());
         auto rest = token2 - amount2_in;
-        auto lq_tokens = count_lq_tokens(lq_supply, amount2_in, current_pool.token2);
+        auto lq_tokens = count_lq_tokens(lq_supply, amount2_in, reserve2);
         if (rest.quantity.amount == 1)
             return std::make_tuple(lq_tokens, token1, amount2_in + rest, extended_asset());
         else
@@ -702,7 +1734,7 @@ swap::count_deposit_amounts(const asset &lq_supply, const pool &current_pool, co
         if (amount2_in < token2)
         {
             auto rest = token2 - amount2_in;
-            auto lq_tokens = count_lq_tokens(lq_supply, token1, current_pool.token1);
+            auto lq_tokens = count_lq_tokens(lq_supply, token1, reserve1);
             if (rest.quantity.amount == 1)
                 return std::make_tuple(lq_tokens, token1, amount2_in + rest, extended_asset());
             else
@@ -710,12 +1742,12 @@ swap::count_deposit_amounts(const asset &lq_supply, const pool &current_pool, co
         }
         else if (token2 < amount2_in)
         {
-            auto lq_tokens = count_lq_tokens(lq_supply, token1, current_pool.token1);
+            auto lq_tokens = count_lq_tokens(lq_supply, token1, reserve1);
             return std::make_tuple(lq_tokens, token1, token2, extended_asset());
         }
         else
         {
-            auto lq_tokens = count_lq_tokens(lq_supply, token1, current_pool.token1);
+            auto lq_tokens = count_lq_tokens(lq_supply, token1, reserve1);
             return std::make_tuple(lq_tokens, token1, token2, extended_asset());
         }
     }
@@ -724,18 +1756,19 @@ swap::count_deposit_amounts(const asset &lq_supply, const pool &current_pool, co
 std::tuple<asset, extended_asset, extended_asset, extended_asset>
 swap::count_add_lq_amounts(const uint64_t &pool_id, const extended_asset &token1, const extended_asset &token2)
 {
-    pools _pools(get_self(), get_self().value);
+    auto &_pools = get_pools();
     const auto &pool = _pools.get(pool_id, "no pool object found");
     auto supply = get_lq_supply(pool.code);
+    auto [reserve1, reserve2] = get_pool_reserves(pool_id);
 
-    if (is_initial_add_lq(supply, pool.token1, pool.token2))
+    if (is_initial_add_lq(supply, reserve1, reserve2))
     {
         auto value = std::sqrt(token1.quantity.amount * token2.quantity.amount);
         return std::make_tuple(asset(value, supply.symbol), token1, token2, extended_asset());
     }
     else
     {
-        auto [lq_tokens, token1_in, token2_in, rest] = count_deposit_amounts(supply, pool, token1, token2);
+        auto [lq_tokens, token1_in, token2_in, rest] = count_deposit_amounts(supply, reserve1, reserve2, token1, token2);
         return std::make_tuple(lq_tokens, token1_in, token2_in, rest);
     }
 }
@@ -750,6 +1783,190 @@ swap::count_earnings_amounts(const asset &lqtokens)
     return std::make_tuple(extended_asset(amount1, token1.get_extended_symbol()), extended_asset(amount2, token2.get_extended_symbol()));
 }
 
+extended_asset swap::count_zap_swap_amount(const uint64_t &pool_id, const extended_asset &income)
+{
+    auto &_pools = get_pools();
+    const auto &pool = _pools.get(pool_id, "no pool object found");
+    auto [reserve1, reserve2] = get_pool_reserves(pool_id);
+    check(reserve1.quantity.amount > 0 && reserve2.quantity.amount > 0, "count_zap_swap_amount : pool has no liquidity");
+
+    //Share of the income to swap so that the rest and the swap output match the pool ratio
+    auto is_token1_in = income.get_extended_symbol() == reserve1.get_extended_symbol();
+    auto reserve_in = is_token1_in ? reserve1 : reserve2;
+    auto reserve_out = is_token1_in ? reserve2 : reserve1;
+    if ((curve_type)pool.curve.value_or() == curve_type::constant_product)
+    {
+        auto fee = (double)(pool.pool_fee.amount + pool.platform_fee.amount) / (double)10000;
+        auto r = (double)reserve_in.quantity.amount;
+        auto a = (double)income.quantity.amount;
+        auto value = (std::sqrt(r * r * (2 - fee) * (2 - fee) + 4 * (1 - fee) * a * r) - r * (2 - fee)) / (2 * (1 - fee));
+        return extended_asset(value, income.get_extended_symbol());
+    }
+
+    //Other curves have no closed form. The rest minus the pool ratio of the output only falls as the swapped
+    //part grows, so the split is found by bisection on the same kernel and fees the swap runs.
+    auto value = with_curve(pool.curve.value_or(), [&](auto curve) {
+        auto is_rest_above = [&](const int64_t &amount) {
+            auto [pool_fee, platform_fee] = count_swap_fees(extended_asset(amount, income.get_extended_symbol()), pool.pool_fee, pool.platform_fee);
+            auto amount_in = amount - pool_fee.quantity.amount - platform_fee.quantity.amount;
+            if (amount_in <= 0)
+            {
+                return true;
+            }
+            auto amount_out = curve.get_amount_out(reserve_in.quantity.amount, reserve_out.quantity.amount, amount_in, pool.amp.value_or());
+            auto rest = (uint128_t)(income.quantity.amount - amount) * (uint128_t)(reserve_out.quantity.amount - amount_out);
+            return rest >= (uint128_t)amount_out * (uint128_t)(reserve_in.quantity.amount + amount_in + pool_fee.quantity.amount);
+        };
+
+        int64_t low = 0;
+        int64_t high = income.quantity.amount;
+        for (uint8_t i = 0; i < max_fill_steps && high - low > 1; ++i)
+        {
+            auto middle = low + (high - low) / 2;
+            if (is_rest_above(middle))
+            {
+                low = middle;
+            }
+            else
+            {
+                high = middle;
+            }
+        }
+        return low;
+    });
+    return extended_asset(value, income.get_extended_symbol());
+}
+
+extended_asset swap::count_swap_in_amount(const uint64_t &pool_id, const extended_asset &amount_out)
+{
+    auto quote = get_pool_quote(pool_id);
+    auto is_token1_out = amount_out.get_extended_symbol() == quote.reserve1.get_extended_symbol();
+    auto reserve_in = is_token1_out ? quote.reserve2 : quote.reserve1;
+    auto reserve_out = is_token1_out ? quote.reserve1 : quote.reserve2;
+    check(reserve_in.quantity.amount > 0, "count_swap_in_amount : pool has no liquidity");
+    check(amount_out.quantity.amount < reserve_out.quantity.amount, "count_swap_in_amount : not enough liquidity for out amount");
+
+    //Inverse of the pool curve with fees, off by rounding only, so the forward check moves it one unit at a time
+    auto fee = (double)(quote.pool_fee.amount + quote.platform_fee.amount) / (double)10000;
+    auto amount_in = with_curve(quote.curve, [&](auto curve) {
+        return curve.get_amount_in(reserve_in.quantity.amount, reserve_out.quantity.amount, amount_out.quantity.amount, quote.amp);
+    });
+    extended_asset income(std::ceil(amount_in / (1 - fee)), reserve_in.get_extended_symbol());
+    auto is_enough = [&](const int64_t &amount) {
+        return std::get<1>(count_swap_amounts(quote, extended_asset(amount, income.get_extended_symbol()))).quantity.amount >= amount_out.quantity.amount;
+    };
+
+    //Smallest income that gives the amount out: up while short of it, down while one less still gives it
+    for (uint8_t i = 0; i < max_inverse_steps; ++i)
+    {
+        if (!is_enough(income.quantity.amount))
+        {
+            income.quantity.amount += 1;
+        }
+        else if (income.quantity.amount > 1 && is_enough(income.quantity.amount - 1))
+        {
+            income.quantity.amount -= 1;
+        }
+        else
+        {
+            return income;
+        }
+    }
+    check(false, "count_swap_in_amount : can not count income for out amount");
+    return income;
+}
+
+extended_asset swap::count_partial_fill(const std::vector<uint64_t> &pool_ids, const extended_asset &income, const uint64_t &min_amount)
+{
+    //Every hop is read once, the amounts below are counted in memory
+    scratch_vector<pool_quote> quotes;
+    quotes.reserve(pool_ids.size());
+    for (const auto &pool_id : pool_ids)
+    {
+        quotes.push_back(get_pool_quote(pool_id));
+    }
+
+    auto is_filled = [&](const int64_t &amount) {
+        extended_asset temp_income(amount, income.get_extended_symbol());
+        for (const auto &quote : quotes)
+        {
+            if (temp_income.quantity.amount < min_swap_amount)
+            {
+                return false;
+            }
+            temp_income = std::get<1>(count_swap_amounts(quote, temp_income));
+        }
+        return (uint128_t)temp_income.quantity.amount * income.quantity.amount >= (uint128_t)min_amount * amount;
+    };
+
+    if (is_filled(income.quantity.amount))
+    {
+        return income;
+    }
+
+    int64_t low = min_swap_amount;
+    int64_t high = income.quantity.amount;
+    check(low < high && is_filled(low), "count_partial_fill : amount out less than min required");
+
+    //On one constant product hop out / in = r_out * (1 - fee) / (r_in + in * (1 - fee)), so the largest part at the
+    //min price p = min / income is r_out / p - r_in / (1 - fee). Rounding is settled by stepping around it.
+    if (quotes.size() == 1 && (curve_type)quotes[0].curve == curve_type::constant_product)
+    {
+        const auto &quote = quotes[0];
+        auto is_token1_in = income.get_extended_symbol() == quote.reserve1.get_extended_symbol();
+        auto reserve_in = (double)(is_token1_in ? quote.reserve1 : quote.reserve2).quantity.amount;
+        auto reserve_out = (double)(is_token1_in ? quote.reserve2 : quote.reserve1).quantity.amount;
+        auto fee = (double)(quote.pool_fee.amount + quote.platform_fee.amount) / (double)10000;
+        auto value = reserve_out * (double)income.quantity.amount / (double)min_amount - reserve_in / (1 - fee);
+        auto middle = (int64_t)std::max(std::min(value, (double)high - 1), (double)low);
+        for (uint8_t i = 0; i < max_inverse_steps && is_filled(middle + 1); ++i)
+        {
+            ++middle;
+        }
+        for (uint8_t i = 0; i < max_inverse_steps && middle > low && !is_filled(middle); ++i)
+        {
+            --middle;
+        }
+        //The estimate is within rounding of the answer, a larger miss falls back to bisection
+        if (is_filled(middle) && !is_filled(middle + 1))
+        {
+            return extended_asset(middle, income.get_extended_symbol());
+        }
+    }
+
+    for (uint8_t i = 0; i < max_fill_steps && high - low > 1; ++i)
+    {
+        auto middle = low + (high - low) / 2;
+        if (is_filled(middle))
+        {
+            low = middle;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return extended_asset(low, income.get_extended_symbol());
+}
+
+double swap::count_batch_price(const int64_t &reserve1, const int64_t &reserve2, const int64_t &amount1_in, const int64_t &amount2_in)
+{
+    //Price of token1 in token2 at which only the net residual goes through the constant product curve
+    auto r1 = (double)reserve1;
+    auto r2 = (double)reserve2;
+    auto net1 = ((double)amount1_in * r2 - (double)amount2_in * r1) / (r2 + (double)amount2_in);
+
+    if (net1 >= 0)
+    {
+        return r2 / (r1 + net1);
+    }
+    else
+    {
+        auto net2 = ((double)amount2_in * r1 - (double)amount1_in * r2) / (r1 + (double)amount1_in);
+        return (r2 + net2) / r1;
+    }
+}
+
 extended_asset swap::count_platform_fee(const asset &platform_fee, const extended_asset &income)
 {
     return income.quantity.amount <= 2000 ? extended_asset(1, income.get_extended_symbol())
@@ -768,29 +1985,32 @@ swap::count_swap_fees(const extended_asset &income, const asset &pool_fee, const
 std::tuple<extended_asset, extended_asset, extended_asset, extended_asset, name, double>
 swap::count_swap_amounts(const uint64_t &pool_id, const extended_asset &income)
 {
-    pools _pools(get_self(), get_self().value);
-    const auto &pool = _pools.get(pool_id, "no pool object found");
+    return count_swap_amounts(get_pool_quote(pool_id), income);
+}
 
-    auto [pool_fee, platform_fee] = count_swap_fees(income, pool.pool_fee, pool.platform_fee);
+std::tuple<extended_asset, extended_asset, extended_asset, extended_asset, name, double>
+swap::count_swap_amounts(const pool_quote &quote, const extended_asset &income)
+{
+    auto [pool_fee, platform_fee] = count_swap_fees(income, quote.pool_fee, quote.platform_fee);
     auto amount_in = income - pool_fee - platform_fee;
-    auto k = (double)pool.token1.quantity.amount * (double)pool.token2.quantity.amount;
+    auto [reserve_in, reserve_out] = amount_in.get_extended_symbol() == quote.reserve1.get_extended_symbol() ? std::make_tuple(quote.reserve1, quote.reserve2)
+                                                                                                             : std::make_tuple(quote.reserve2, quote.reserve1);
+    check(reserve_in.quantity.amount > 0 && reserve_out.quantity.amount > 0, "count_swap_amounts : pool has no liquidity");
 
-    if (amount_in.get_extended_symbol() == pool.token1.get_extended_symbol())
-    {
-        auto total_token1 = pool.token1 + amount_in;
-        extended_asset total_token2(k / (double)total_token1.quantity.amount, pool.token2.get_extended_symbol());
-        auto amount_out = pool.token2 - total_token2;
-        auto price = (double)amount_out.quantity.amount / (double)amount_in.quantity.amount;
-        return std::make_tuple(amount_in, amount_out, pool_fee, platform_fee, pool.fee_receiver, price);
-    }
-    else
-    {
-        auto total_token2 = pool.token2 + amount_in;
-        extended_asset total_token1(k / (double)total_token2.quantity.amount, pool.token1.get_extended_symbol());
-        auto amount_out = pool.token1 - total_token1;
-        auto price = (double)amount_out.quantity.amount / (double)amount_in.quantity.amount;
-        return std::make_tuple(amount_in, amount_out, pool_fee, platform_fee, pool.fee_receiver, price);
-    }
+    auto out = with_curve(quote.curve, [&](auto curve) {
+        return curve.get_amount_out(reserve_in.quantity.amount, reserve_out.quantity.amount, amount_in.quantity.amount, quote.amp);
+    });
+    extended_asset amount_out(out, reserve_out.get_extended_symbol());
+    auto price = (double)amount_out.quantity.amount / (double)amount_in.quantity.amount;
+    return std::make_tuple(amount_in, amount_out, pool_fee, platform_fee, quote.fee_receiver, price);
+}
+
+pool_quote swap::get_pool_quote(const uint64_t &pool_id)
+{
+    auto &_pools = get_pools();
+    const auto &pool = _pools.get(pool_id, "no pool object found");
+    auto [reserve1, reserve2] = get_pool_reserves(pool_id);
+    return pool_quote{reserve1, reserve2, pool.pool_fee, pool.platform_fee, pool.fee_receiver, pool.curve.value_or(), pool.amp.value_or()};
 }
 
 uint64_t swap::get_new_pool_id(const uint64_t &available_id)
@@ -815,28 +2035,159 @@ symbol swap::to_pool_symbol(uint64_t pool_id)
     return symbol(symbol_code(code.c_str()), 0);
 }
 
-std::vector<uint64_t> swap::to_uint64_ids(const std::vector<std::string> &str)
+std::vector<uint64_t> swap::to_uint64_ids(const scratch_vector<std::string_view> &str)
 {
     std::vector<uint64_t> result;
-    for (auto i : str)
+    result.reserve(str.size());
+    for (const auto &i : str)
     {
-        result.push_back(std::stoull(i));
+        result.push_back(to_uint64(i));
     }
     return result;
 }
 
+std::vector<extended_symbol> swap::get_route_tokens(const extended_symbol &token_in, const std::vector<uint64_t> &pool_ids, const std::string_view &assert_prefix)
+{
+    //Tokens along the route, the last one is paid out
+    std::vector<extended_symbol> tokens{token_in};
+    for (const auto &pool_id : pool_ids)
+    {
+        check(is_pool_match(pool_id, extended_asset(0, tokens.back())), assert_prefix, "pool is not matched with tokens");
+        auto [reserve1, reserve2] = get_pool_reserves(pool_id);
+        tokens.push_back(tokens.back() == reserve1.get_extended_symbol() ? reserve2.get_extended_symbol() : reserve1.get_extended_symbol());
+    }
+    return tokens;
+}
+
+uint64_t swap::get_next_route_id(const routes &_routes)
+{
+    route_counters _counter(get_self(), get_self().value);
+    //Before the counter existed ids came from the table, so it starts above the highest of them
+    auto counter = _counter.exists() ? _counter.get() : route_counter{_routes.available_primary_key()};
+    auto route_id = counter.next_id++;
+    _counter.set(counter, get_self());
+    return route_id;
+}
+
+uint64_t swap::get_next_intent_id(const intents &_intents, const uint64_t &pool_id)
+{
+    intent_counters _counter(get_self(), pool_id);
+    //Before the counter existed ids came from the table, so it starts above the highest of them
+    auto counter = _counter.exists() ? _counter.get() : intent_counter{_intents.available_primary_key()};
+    auto intent_id = counter.next_id++;
+    _counter.set(counter, get_self());
+    return intent_id;
+}
+
+void swap::erase_route(const uint64_t &route_id)
+{
+    routes _routes(get_self(), get_self().value);
+    auto it = _routes.find(route_id);
+    if (it == _routes.end())
+    {
+        return;
+    }
+
+    route_counts _counts(get_self(), it->owner.value);
+    for (const auto &pool_id : it->pool_ids)
+    {
+        route_refs _refs(get_self(), pool_id);
+        auto ref = _refs.find(route_id);
+        if (ref == _refs.end())
+        {
+            continue;
+        }
+        _refs.erase(ref);
+
+        //Routes registered before the counts existed have no row to take from
+        auto count = _counts.find(pool_id);
+        if (count == _counts.end())
+        {
+            continue;
+        }
+        if (count->count <= 1)
+        {
+            _counts.erase(count);
+            continue;
+        }
+        _counts.modify(count, same_payer, [&](auto &a) {
+            --a.count;
+        });
+    }
+    _routes.erase(it);
+}
+
+accounts &swap::get_accounts(const name &owner)
+{
+    return accounts_tables.try_emplace(owner.value, get_self(), owner.value).first->second;
+}
+
+stats &swap::get_stats(const symbol_code &code)
+{
+    return stats_tables.try_emplace(code.raw(), get_self(), code.raw()).first->second;
+}
+
+pools &swap::get_pools()
+{
+    if (!pools_table)
+    {
+        pools_table.emplace(get_self(), get_self().value);
+    }
+    return *pools_table;
+}
+
+pool_states &swap::get_pool_states(const uint64_t &pool_id)
+{
+    return pool_states_tables.try_emplace(pool_id, get_self(), pool_id).first->second;
+}
+
+inheritance &swap::get_inheritance()
+{
+    if (!inheritance_table)
+    {
+        inheritance_table.emplace(get_self(), get_self().value);
+    }
+    return *inheritance_table;
+}
+
+const std::optional<notify_policy> &swap::get_notify_policy(const name &owner)
+{
+    auto it = notify_policy_rows.find(owner.value);
+    if (it == notify_policy_rows.end())
+    {
+        notify_policies _policies(get_self(), get_self().value);
+        auto row = _policies.find(owner.value);
+        it = notify_policy_rows.emplace(owner.value, row == _policies.end() ? std::optional<notify_policy>() : std::optional<notify_policy>(*row)).first;
+    }
+    return it->second;
+}
+
 asset swap::get_lq_supply(const symbol_code &token)
 {
-    stats statstable(get_self(), token.raw());
+    auto &statstable = get_stats(token);
     const auto &obj = statstable.get(token.raw(), "no stat object found");
     return obj.supply;
 }
 
 std::tuple<extended_asset, extended_asset> swap::get_pool_tokens(const symbol_code &pool_code)
 {
-    pools _pools(get_self(), get_self().value);
+    auto &_pools = get_pools();
     auto index = _pools.get_index<name("bycode")>();
     const auto &pool = index.get(pool_code.raw(), "pool object not found");
+    return get_pool_reserves(pool.id);
+}
+
+std::tuple<extended_asset, extended_asset> swap::get_pool_reserves(const uint64_t &pool_id)
+{
+    auto &_states = get_pool_states(pool_id);
+    auto it = _states.find(pool_id);
+    if (it != _states.end())
+    {
+        return std::make_tuple(it->token1, it->token2);
+    }
+
+    auto &_pools = get_pools();
+    const auto &pool = _pools.get(pool_id, "no pool object found");
     return std::make_tuple(pool.token1, pool.token2);
 }
 
@@ -852,7 +2203,7 @@ transaction swap::get_income_trx()
 
 uint64_t swap::get_pool_id(const symbol_code &code)
 {
-    pools _pools(get_self(), get_self().value);
+    auto &_pools = get_pools();
     auto index = _pools.get_index<name("bycode")>();
     const auto &pool = index.get(code.raw(), "no pool object found");
     return pool.id;
@@ -872,6 +2223,14 @@ bool swap::is_account_exist(const name &owner, const extended_symbol &token)
     return it != _accounts.end() ? true : false;
 }
 
+bool swap::is_vault_exist(const name &owner, const extended_symbol &token)
+{
+    vaults _vaults(get_self(), owner.value);
+    auto index = _vaults.get_index<name("bytoken")>();
+    auto it = index.find(to_token_key(token));
+    return it != index.end() && it->balance.quantity.symbol == token.get_symbol() ? true : false;
+}
+
 bool swap::is_valid_deposits(const std::vector<deposit> &deposits)
 {
     return (deposits.size() == 2 && deposits[0].from == deposits[1].from && deposits[0].memo == deposits[1].memo) ? true : false;
@@ -891,7 +2250,7 @@ bool swap::is_token_exist(const extended_symbol &token)
 
 bool swap::is_lq_tokens(const extended_symbol &token)
 {
-    pools _pools(get_self(), get_self().value);
+    auto &_pools = get_pools();
     auto index = _pools.get_index<name("bycode")>();
     auto it = index.find(token.get_symbol().code().raw());
     return it != index.end() && token.get_contract() == get_self() ? true : false;
@@ -899,14 +2258,14 @@ bool swap::is_lq_tokens(const extended_symbol &token)
 
 bool swap::is_pool_exist(const uint64_t &pool_id)
 {
-    pools _pools(get_self(), get_self().value);
+    auto &_pools = get_pools();
     auto it = _pools.find(pool_id);
     return it != _pools.end() ? true : false;
 }
 
 bool swap::is_pool_exist(const symbol_code &code)
 {
-    pools _pools(get_self(), get_self().value);
+    auto &_pools = get_pools();
     auto index = _pools.get_index<name("bycode")>();
     auto it = index.find(code.raw());
     return it != index.end() ? true : false;
@@ -914,7 +2273,7 @@ bool swap::is_pool_exist(const symbol_code &code)
 
 bool swap::is_pool_exist(const extended_symbol &token1, const extended_symbol &token2)
 {
-    pools _pools(get_self(), get_self().value);
+    auto &_pools = get_pools();
     auto index = _pools.get_index<name("bypair")>();
     auto hash1 = to_pair_hash(token1, token2);
     auto hash2 = to_pair_hash(token2, token1);
@@ -935,7 +2294,7 @@ bool swap::is_pools_exist(const std::vector<uint64_t> &pool_ids)
 
 bool swap::is_pool_match(const uint64_t &pool_id, const extended_asset &income)
 {
-    pools _pools(get_self(), get_self().value);
+    auto &_pools = get_pools();
     const auto &obj = _pools.get(pool_id, "no pool object found");
     auto symb = income.get_extended_symbol();
     return symb == obj.token1.get_extended_symbol() || symb == obj.token2.get_extended_symbol() ? true : false;
@@ -943,7 +2302,7 @@ bool swap::is_pool_match(const uint64_t &pool_id, const extended_asset &income)
 
 bool swap::is_pool_match(const uint64_t &pool_id, const extended_asset &token1, const extended_asset &token2)
 {
-    pools _pools(get_self(), get_self().value);
+    auto &_pools = get_pools();
     auto index = _pools.get_index<name("bypair")>();
     auto hash = to_pair_hash(token1.get_extended_symbol(), token2.get_extended_symbol());
     auto it = index.find(hash);
@@ -957,44 +2316,112 @@ bool swap::is_last_deposit(const deposit &current_deposit, const std::vector<dep
 
 bool swap::is_swap_memo(const std::string &memo)
 {
-    return swap_prefix == memo.substr(0, swap_prefix.size()) ? true : false;
+    return has_prefix(memo, swap_prefix);
 }
 
 bool swap::is_deposit_memo(const std::string &memo)
 {
-    return deposit_prefix == memo.substr(0, deposit_prefix.size()) ? true : false;
+    return has_prefix(memo, deposit_prefix);
 }
 
-std::tuple<bool, std::vector<uint64_t>, uint64_t>
-swap::is_valid_swap_memo(const std::map<std::string, std::string> &params)
+bool swap::is_compact_memo(const std::string &memo)
+{
+    return has_prefix(memo, compact_prefix);
+}
+
+bool swap::is_zap_memo(const std::string &memo)
+{
+    return has_prefix(memo, zap_prefix);
+}
+
+bool swap::is_vault_memo(const std::string &memo)
+{
+    return has_prefix(memo, vault_prefix);
+}
+
+std::tuple<bool, std::vector<uint64_t>, uint64_t, bool>
+swap::is_valid_swap_memo(const memo_params &params)
 {
+    INSTR_PHASE(memo);
     auto sw_it = params.find("swap");
     auto min_it = params.find("min");
+    auto fill_it = params.find("fill");
 
     if (params.size() == 1 && sw_it != params.end())
     {
         auto result = split(sw_it->second, "-");
         check(is_digit(result), "is_valid_swap_memo : invalid pool ids");
-        return std::make_tuple(true, to_uint64_ids(result), (uint64_t)1);
+        return std::make_tuple(true, to_uint64_ids(result), (uint64_t)1, false);
     }
     else if (params.size() == 2 && sw_it != params.end() && min_it != params.end())
     {
         check(is_digit(min_it->second), "is_valid_swap_memo : invalid min amount");
         auto result = split(sw_it->second, "-");
         check(is_digit(result), "is_valid_swap_memo : invalid pool ids");
-        return std::make_tuple(true, to_uint64_ids(result), std::stoull(min_it->second));
+        return std::make_tuple(true, to_uint64_ids(result), to_uint64(min_it->second), false);
+    }
+    else if (params.size() == 3 && sw_it != params.end() && min_it != params.end() && fill_it != params.end())
+    {
+        check(fill_it->second == "partial", "is_valid_swap_memo : invalid fill mode");
+        check(is_digit(min_it->second), "is_valid_swap_memo : invalid min amount");
+        auto result = split(sw_it->second, "-");
+        check(is_digit(result), "is_valid_swap_memo : invalid pool ids");
+        return std::make_tuple(true, to_uint64_ids(result), to_uint64(min_it->second), true);
+    }
+    return std::make_tuple(false, std::vector<uint64_t>(), (uint64_t)1, false);
+}
+
+std::tuple<bool, compact_swap>
+swap::is_valid_compact_memo(const std::string &memo)
+{
+    INSTR_PHASE(memo);
+    compact_swap result{};
+    auto status = decode_compact_memo(memo, result);
+    return std::make_tuple(status, result);
+}
+
+std::tuple<bool, uint64_t, uint64_t>
+swap::is_valid_route_memo(const memo_params &params)
+{
+    INSTR_PHASE(memo);
+    auto sw_it = params.find("swap");
+    auto min_it = params.find("min");
+
+    if (params.size() == 2 && sw_it != params.end() && min_it != params.end())
+    {
+        auto route_id = sw_it->second.substr(route_prefix.size());
+        check(!route_id.empty() && is_digit(route_id), "is_valid_route_memo : invalid route id");
+        check(is_digit(min_it->second), "is_valid_route_memo : invalid min amount");
+        return std::make_tuple(true, to_uint64(route_id), to_uint64(min_it->second));
+    }
+    return std::make_tuple(false, (uint64_t)0, (uint64_t)0);
+}
+
+std::tuple<bool, std::vector<uint64_t>, uint64_t>
+swap::is_valid_swap_out_memo(const memo_params &params)
+{
+    INSTR_PHASE(memo);
+    auto sw_it = params.find("swap");
+    auto out_it = params.find("out");
+
+    if (params.size() == 2 && sw_it != params.end() && out_it != params.end())
+    {
+        check(is_digit(out_it->second), "is_valid_swap_out_memo : invalid out amount");
+        auto result = split(sw_it->second, "-");
+        check(is_digit(result), "is_valid_swap_out_memo : invalid pool ids");
+        return std::make_tuple(true, to_uint64_ids(result), to_uint64(out_it->second));
     }
-    return std::make_tuple(false, std::vector<uint64_t>(), (uint64_t)1);
+    return std::make_tuple(false, std::vector<uint64_t>(), (uint64_t)0);
 }
 
-bool swap::is_digit(const std::string &str)
+bool swap::is_digit(const std::string_view &str)
 {
-    return str.find_first_not_of("0123456789") == std::string::npos ? true : false;
+    return str.find_first_not_of("0123456789") == std::string_view::npos ? true : false;
 }
 
-bool swap::is_digit(const std::vector<std::string> &str)
+bool swap::is_digit(const scratch_vector<std::string_view> &str)
 {
-    for (auto i : str)
+    for (const auto &i : str)
     {
         if (!is_digit(i))
             return false;
@@ -1003,14 +2430,15 @@ bool swap::is_digit(const std::vector<std::string> &str)
 }
 
 std::tuple<bool, uint64_t>
-swap::is_valid_deposit_memo(const std::map<std::string, std::string> &params)
+swap::is_valid_deposit_memo(const memo_params &params)
 {
+    INSTR_PHASE(memo);
     auto it = params.find("deposit");
 
     if (params.size() == 1 && it != params.end())
     {
         check(is_digit(it->second), "is_valid_deposit_memo : invalid pool id");
-        return std::make_tuple(true, std::stoull(it->second));
+        return std::make_tuple(true, to_uint64(it->second));
     }
     else
     {
@@ -1018,6 +2446,57 @@ swap::is_valid_deposit_memo(const std::map<std::string, std::string> &params)
     }
 }
 
+std::tuple<bool, uint64_t, uint64_t>
+swap::is_valid_zap_memo(const memo_params &params)
+{
+    INSTR_PHASE(memo);
+    auto zap_it = params.find("zap");
+    auto min_it = params.find("min");
+
+    if (params.size() == 1 && zap_it != params.end())
+    {
+        check(is_digit(zap_it->second), "is_valid_zap_memo : invalid pool id");
+        return std::make_tuple(true, to_uint64(zap_it->second), (uint64_t)1);
+    }
+    else if (params.size() == 2 && zap_it != params.end() && min_it != params.end())
+    {
+        check(is_digit(zap_it->second), "is_valid_zap_memo : invalid pool id");
+        check(is_digit(min_it->second), "is_valid_zap_memo : invalid min amount");
+        return std::make_tuple(true, to_uint64(zap_it->second), to_uint64(min_it->second));
+    }
+    return std::make_tuple(false, (uint64_t)0, (uint64_t)1);
+}
+
+std::tuple<bool, name>
+swap::is_valid_vault_memo(const memo_params &params)
+{
+    INSTR_PHASE(memo);
+    auto it = params.find("vault");
+
+    if (params.size() == 1 && it != params.end())
+    {
+        name owner(it->second);
+        check(is_account(owner), "is_valid_vault_memo : vault owner account does not exist");
+        return std::make_tuple(true, owner);
+    }
+    else
+    {
+        return std::make_tuple(false, name());
+    }
+}
+
+bool swap::is_notification_enabled(const name &owner, bool notify_policy::*kind)
+{
+    const auto &global = get_notify_policy(get_self());
+    if (global && (*global).*kind)
+    {
+        return true;
+    }
+
+    const auto &policy = get_notify_policy(owner);
+    return !policy || (*policy).*kind ? true : false;
+}
+
 bool swap::is_valid_inactive_period(const uint32_t &inactive_period)
 {
     return (inactive_period >= min_inh_period && inactive_period <= max_inh_period) ? true : false;
@@ -1037,12 +2516,12 @@ bool swap::is_not_self_in_inheritors(const name &owner, const std::vector<inheri
 
 bool swap::is_inheritors_unique(const std::vector<inheritor_record> &inheritors)
 {
-    std::map<name, asset> mymap;
+    scratch_set<name> names;
     for (auto const &it : inheritors)
     {
-        mymap.emplace(it.inheritor, it.share);
+        names.insert(it.inheritor);
     }
-    return (mymap.size() == inheritors.size() ? true : false);
+    return (names.size() == inheritors.size() ? true : false);
 }
 
 bool swap::is_valid_inheritors_amount(const size_t &size)
@@ -1052,12 +2531,12 @@ bool swap::is_valid_inheritors_amount(const size_t &size)
 
 bool swap::is_valid_share(const asset &share)
 {
-    return (share.symbol == inh_percent && share >= min_percent && share <= max_percent) ? true : false;
+    return (share.symbol == inh_percent && share.amount >= min_percent_amount && share.amount <= max_percent_amount) ? true : false;
 }
 
 bool swap::is_valid_share_sum(const asset &sum)
 {
-    return (sum == max_percent ? true : false);
+    return (sum.amount == max_percent_amount ? true : false);
 }
 
 bool swap::is_valid_inheritors(const std::vector<inheritor_record> &inheritors)
@@ -1077,72 +2556,123 @@ bool swap::is_valid_inheritors(const std::vector<inheritor_record> &inheritors)
 
 void swap::send_issue(const name &to, const asset &quantity, const std::string &memo)
 {
-    action(
+    INSTR_PHASE(pack);
+    INSTR_INLINE_ACTION();
+    send_scratch(
         permission_level{get_self(), name("active")},
         get_self(),
         name("issue"),
-        std::make_tuple(to, quantity, memo))
-        .send();
+        std::make_tuple(to, quantity, memo));
 }
 
 void swap::send_retire(const name &from, const asset &quantity, const std::string &memo)
 {
-    action(
+    INSTR_PHASE(pack);
+    INSTR_INLINE_ACTION();
+    send_scratch(
         permission_level{get_self(), name("active")},
         get_self(),
         name("retire"),
-        std::make_tuple(from, quantity, memo))
-        .send();
+        std::make_tuple(from, quantity, memo));
 }
 
 void swap::send_transfer(const name &contract, const name &to, const asset &quantity, const std::string &memo)
 {
-    action(
+    INSTR_PHASE(pack);
+    INSTR_INLINE_ACTION();
+    send_scratch(
         permission_level{get_self(), name("active")},
         contract,
         name("transfer"),
-        std::make_tuple(get_self(), to, quantity, memo))
-        .send();
+        std::make_tuple(get_self(), to, quantity, memo));
+}
+
+void swap::send_clean_report(const name &keeper, const name &next_cursor, const symbol_code &next_row_cursor,
+                             const uint32_t &rows_erased, const uint64_t &bytes_freed)
+{
+    INSTR_PHASE(pack);
+    INSTR_INLINE_ACTION();
+    send_scratch(
+        permission_level{get_self(), name("active")},
+        get_self(),
+        name("cleanreport"),
+        std::make_tuple(keeper, next_cursor, next_row_cursor, rows_erased, bytes_freed));
 }
 
 void swap::send_swap_details(const uint64_t &pool_id, const name &owner, const extended_asset &token_in,
                              const extended_asset &token_out, const extended_asset &pool_fee,
                              const extended_asset &platform_fee, const double &price)
 {
-    action(
+    if (!is_notification_enabled(owner, &notify_policy::swap_details))
+    {
+        return;
+    }
+
+    INSTR_PHASE(pack);
+    INSTR_INLINE_ACTION();
+    send_scratch(
         permission_level{get_self(), name("active")},
         get_self(),
         name("swapdetails"),
-        std::make_tuple(pool_id, owner, token_in, token_out, pool_fee, platform_fee, price))
-        .send();
+        std::make_tuple(pool_id, owner, token_in, token_out, pool_fee, platform_fee, price));
+}
+
+//One record per settle, whatever the number of intents, so owners are not notified one by one
+void swap::send_batch_details(const uint64_t &pool_id, const double &price, const batch_side &side1, const batch_side &side2, const std::vector<batch_fill> &fills)
+{
+    INSTR_PHASE(pack);
+    INSTR_INLINE_ACTION();
+    send_scratch(
+        permission_level{get_self(), name("active")},
+        get_self(),
+        name("batchdetails"),
+        std::make_tuple(pool_id, price, side1, side2, fills));
 }
 
 void swap::send_add_lq_details(const uint64_t &pool_id, const name &owner, const asset &lqtoken, const extended_asset &token1, const extended_asset &token2)
 {
-    action(
+    if (!is_notification_enabled(owner, &notify_policy::lq_details))
+    {
+        return;
+    }
+
+    INSTR_PHASE(pack);
+    INSTR_INLINE_ACTION();
+    send_scratch(
         permission_level{get_self(), name("active")},
         get_self(),
         name("addlqdetails"),
-        std::make_tuple(pool_id, owner, lqtoken, token1, token2))
-        .send();
+        std::make_tuple(pool_id, owner, lqtoken, token1, token2));
 }
 
 void swap::send_rmv_lq_details(const uint64_t &pool_id, const name &owner, const asset &lqtoken, const extended_asset &token1, const extended_asset &token2)
 {
-    action(
+    if (!is_notification_enabled(owner, &notify_policy::lq_details))
+    {
+        return;
+    }
+
+    INSTR_PHASE(pack);
+    INSTR_INLINE_ACTION();
+    send_scratch(
         permission_level{get_self(), name("active")},
         get_self(),
         name("rmvlqdetails"),
-        std::make_tuple(pool_id, owner, lqtoken, token1, token2))
-        .send();
+        std::make_tuple(pool_id, owner, lqtoken, token1, token2));
 }
 
 void swap::send_notify(const std::string &action_type, const name &to, const name &from, const asset &quantity, const std::string &memo)
 {
-    action(
+    if (!is_notification_enabled(to, &notify_policy::notify))
+    {
+        return;
+    }
+
+    INSTR_PHASE(pack);
+    INSTR_INLINE_ACTION();
+    send_scratch(
         permission_level{get_self(), name("active")},
         get_self(),
         name("notify"),
-        std::make_tuple(action_type, to, from, quantity, memo))
-        .send();
+        std::make_tuple(action_type, to, from, quantity, memo));
 }
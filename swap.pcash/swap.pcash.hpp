@@ -1,5 +1,8 @@
 #pragma once
 #include <cmath>
+#include <set>
+#include <map>
+#include <optional>
 #include <eosio/eosio.hpp>
 #include <eosio/asset.hpp>
 #include <eosio/system.hpp>
@@ -8,7 +11,14 @@
 #include "inheritrance.hpp"
 #include "stat.hpp"
 #include "pool.hpp"
+#include "pool_state.hpp"
+#include "pool_seq.hpp"
+#include "vault.hpp"
+#include "intent.hpp"
+#include "notification.hpp"
+#include "route.hpp"
 #include "resources.hpp"
+#include "curve.hpp"
 
 using namespace eosio;
 
@@ -16,13 +26,27 @@ class [[eosio::contract("swap.pcash")]] swap : public contract
 {
 public:
     swap(name receiver, name code, datastream<const char *> ds);
+    ~swap();
+
+#ifdef INSTRUMENT
+    //For instrumentation reports
+    [[eosio::action("instrstats")]] void instr_stats(const name &code, const std::vector<instr_table_counters> &tables, const uint32_t &inline_actions, const std::vector<instr_phase_heap> &heap, const uint32_t &peak_heap_bytes, const uint32_t &page_growth, const uint32_t &arena_bytes);
+#endif
 
     [[eosio::action("open")]] void open(const name &owner, const symbol &symbol, const name &ram_payer);
 
     [[eosio::action("close")]] void close(const name &owner, const symbol &symbol);
 
+    [[eosio::action("openmany")]] void open_many(const name &owner, const std::vector<symbol> &symbols, const name &ram_payer);
+
+    [[eosio::action("closemany")]] void close_many(const name &owner, const std::vector<symbol> &symbols);
+
     [[eosio::action("withdraw")]] void withdraw(const name &owner, const asset &lq_tokens);
 
+    [[eosio::action("withdrawmany")]] void withdraw_many(const name &owner, const std::vector<asset> &lq_tokens);
+
+    [[eosio::action("zapout")]] void zap_out(const name &owner, const asset &lq_tokens, const extended_symbol &token, const uint64_t &min_amount);
+
     [[eosio::action("create")]] void create_token(const name &issuer, const asset &maximum_supply);
 
     //For managing liquidity tokens
@@ -32,11 +56,17 @@ public:
 
     [[eosio::action("transfer")]] void transfer_token(const name &from, const name &to, const asset &quantity, const std::string &memo);
 
+    [[eosio::action("transfermany")]] void transfer_many(const name &from, const std::vector<transfer_record> &transfers);
+
     //For managing pools
     [[eosio::action("createpool")]] void create_pool(const name &creator, const extended_symbol &token1, const extended_symbol &token2);
 
+    [[eosio::action("createpools")]] void create_pools(const name &creator, const std::vector<token_pair> &pairs);
+
     [[eosio::action("removepool")]] void remove_pool(const uint64_t &pool_id);
 
+    [[eosio::action("setcurve")]] void set_curve(const uint64_t &pool_id, const uint8_t &curve, const uint64_t &amp);
+
     //For init inheritance distribution
     [[eosio::action("dstrinh")]] void distribute_inheritance(const name &initiator, const name &inheritance_owner, const symbol_code &token);
 
@@ -45,9 +75,40 @@ public:
 
     [[eosio::action("updtokeninhs")]] void update_inheritors(const name &owner, const std::vector<inheritor_record> &inheritors);
 
+    //For RAM reclamation of dormant zero balances and orphaned inheritance rows
+    [[eosio::action("cleanup")]] void cleanup(const name &keeper, const name &cursor, const symbol_code &row_cursor, const uint32_t &max_rows);
+
+    [[eosio::action("cleanreport")]] void clean_report(const name &keeper, const name &next_cursor, const symbol_code &next_row_cursor,
+                                                       const uint32_t &rows_erased, const uint64_t &bytes_freed);
+
+    //For vault balances
+    [[eosio::action("vaultopen")]] void vault_open(const name &owner, const extended_symbol &token, const name &ram_payer);
+
+    [[eosio::action("vaultclose")]] void vault_close(const name &owner, const extended_symbol &token);
+
+    [[eosio::action("vaultwdraw")]] void vault_withdraw(const name &owner, const extended_asset &quantity);
+
+    [[eosio::action("swapexact")]] void swap_exact(const name &owner, const extended_asset &token_in, const std::vector<uint64_t> &pool_ids, const uint64_t &min_amount);
+
+    //For batch auction of swap intents
+    [[eosio::action("swapintent")]] void swap_intent(const name &owner, const uint64_t &pool_id, const extended_asset &token_in, const uint64_t &min_amount);
+
+    [[eosio::action("cancelintent")]] void cancel_intent(const name &owner, const uint64_t &pool_id, const uint64_t &intent_id);
+
+    [[eosio::action("settle")]] void settle(const name &keeper, const uint64_t &pool_id, const uint32_t &max_intents);
+
+    //For registered swap routes
+    [[eosio::action("regroute")]] void register_route(const name &owner, const extended_symbol &token_in, const std::vector<uint64_t> &pool_ids);
+
+    [[eosio::action("rmvroute")]] void remove_route(const name &owner, const uint64_t &route_id);
+
     //For notifying
+    [[eosio::action("setntfpolicy")]] void set_notify_policy(const name &owner, const bool &swap_details, const bool &lq_details, const bool &notify);
+
     [[eosio::action("swapdetails")]] void swap_details(const uint64_t &pool_id, const name &owner, const extended_asset &token_in, const extended_asset &token_out, const extended_asset &pool_fee, const extended_asset &platform_fee, const double &price);
 
+    [[eosio::action("batchdetails")]] void batch_details(const uint64_t &pool_id, const double &price, const batch_side &side1, const batch_side &side2, const std::vector<batch_fill> &fills);
+
     [[eosio::action("addlqdetails")]] void add_lq_details(const uint64_t &pool_id, const name &owner, const asset &lqtoken, const extended_asset &token1, const extended_asset &token2);
 
     [[eosio::action("rmvlqdetails")]] void remove_lq_details(const uint64_t &pool_id, const name &owner, const asset &lqtoken, const extended_asset &token1, const extended_asset &token2);
@@ -58,22 +119,69 @@ public:
     [[eosio::on_notify("*::transfer")]] void on_transfer(const name &from, const name &to, const asset &quantity, const std::string &memo);
 
 private:
+    //Table handles shared by the whole action, so a row read once stays in the multi_index cache
+    std::map<uint64_t, accounts> accounts_tables;
+    std::map<uint64_t, stats> stats_tables;
+    std::optional<inheritance> inheritance_table;
+    std::optional<pools> pools_table;
+    std::map<uint64_t, pool_states> pool_states_tables;
+    //Notification policies read once per action, an empty entry means the account has no row
+    std::map<uint64_t, std::optional<notify_policy>> notify_policy_rows;
+    //Pools changed by the action with their removed flag, stamped once in poolseq by the destructor
+    std::map<uint64_t, bool> changed_pools;
+
+    accounts &get_accounts(const name &owner);
+    stats &get_stats(const symbol_code &code);
+    inheritance &get_inheritance();
+    pools &get_pools();
+    pool_states &get_pool_states(const uint64_t &pool_id);
+    const std::optional<notify_policy> &get_notify_policy(const name &owner);
+
     void on_transfer_self_token(const name &from, const name &to, const asset &quantity, const std::string &memo);
 
-    void do_swap(const name &from, const asset &quantity, const std::string &memo, const std::string &assert_prefix);
-    void do_deposit(const name &from, const asset &quantity, const std::string &memo, const std::string &assert_prefix);
+    void do_swap(const name &from, const asset &quantity, const std::string &memo, const std::string_view &assert_prefix);
+    void do_deposit(const name &from, const asset &quantity, const std::string &memo, const std::string_view &assert_prefix);
+    std::tuple<uint64_t, extended_asset, extended_asset>
+    do_withdraw(const name &owner, const asset &lq_tokens, const std::string_view &assert_prefix);
+    std::tuple<uint64_t, extended_asset, extended_asset>
+    do_remove_liquidity(const asset &lq_tokens, const std::string_view &assert_prefix);
+
+    void do_zap(const name &from, const asset &quantity, const std::string &memo, const std::string_view &assert_prefix);
+    void do_vault_deposit(const name &from, const asset &quantity, const std::string &memo, const std::string_view &assert_prefix);
+
+    void do_compact_swap(const name &from, const asset &quantity, const std::string &memo, const std::string_view &assert_prefix);
+    void do_swap_pools(const name &from, const asset &quantity, const std::vector<uint64_t> &pool_ids, const uint64_t &min_amount, const bool &is_partial, const std::string_view &assert_prefix);
+    void do_swap_out(const name &from, const asset &quantity, const memo_params &params, const std::string_view &assert_prefix);
+    void do_swap_registered(const name &from, const asset &quantity, const memo_params &params, const std::string_view &assert_prefix);
+    extended_asset do_swap_route(const name &from, const extended_asset &income, const std::vector<uint64_t> &pool_ids, const bool &internal, const bool &is_route_checked, const std::string_view &assert_prefix);
 
     void add_balance(const name &user, const asset &quantity, const name &ram_payer);
     void sub_balance(const name &user, const asset &quantity);
 
+    void add_vault_balance(const name &owner, const extended_asset &value, const name &ram_payer, const int32_t &intents = 0);
+    void sub_vault_balance(const name &owner, const extended_asset &value, const int32_t &intents = 0);
+
     void add_pool_balance(const uint64_t &pool_id, const extended_asset &token1, const extended_asset &token2);
     void sub_pool_balance(const uint64_t &pool_id, const extended_asset &token1, const extended_asset &token2);
 
-    void add_pool_balance(const uint64_t &pool_id, const extended_asset &tokens);
-    void sub_pool_balance(const uint64_t &pool_id, const extended_asset &tokens);
+    void exchange_pool_balance(const uint64_t &pool_id, const extended_asset &tokens_in, const extended_asset &tokens_out,
+                               const extended_asset &volume, const extended_asset &fee);
+
+    void update_pool_state(const uint64_t &pool_id, const extended_asset &token1, const extended_asset &token2,
+                           const int64_t &volume1, const int64_t &volume2, const int64_t &fee1, const int64_t &fee2);
+    void archive_volume(const uint64_t &pool_id, const volume_bucket &bucket);
+    void stamp_pool_seq(const uint64_t &pool_id, const bool &removed);
+    void flush_pool_seqs();
+#ifdef INSTRUMENT
+    void report_instr_stats();
+#endif
+    void migrate_pool_state(const uint64_t &pool_id);
 
     void create_inheritance(const name &owner, const name &ram_payer);
     void close_inheritance(const name &owner);
+    std::vector<extended_symbol> get_route_tokens(const extended_symbol &token_in, const std::vector<uint64_t> &pool_ids, const std::string_view &assert_prefix);
+    void emplace_pool(pools &_pools, const name &creator, const uint64_t &id, const extended_symbol &token1, const extended_symbol &token2);
+    void erase_route(const uint64_t &route_id);
     void extend_inheritance(const name &owner, const name &ram_payer);
 
     void add_inh_balances(const name &owner, const asset &value, const std::vector<inheritor_record> &inheritors, const name &ram_payer);
@@ -84,20 +192,20 @@ private:
 
     std::vector<deposit> parse_deposit_actions(const transaction &trx);
 
-    std::vector<std::string>
-    split(const std::string &s, const std::string &delimiter);
+    scratch_vector<std::string_view>
+    split(const std::string_view &s, const std::string_view &delimiter);
 
-    std::map<std::string, std::string>
+    memo_params
     to_key_value(const std::string &memo);
     symbol to_pool_symbol(uint64_t pool_id);
-    std::vector<uint64_t> to_uint64_ids(const std::vector<std::string> &str);
+    std::vector<uint64_t> to_uint64_ids(const scratch_vector<std::string_view> &str);
 
     asset count_share(const asset &quantity, const asset &share);
 
     asset count_lq_tokens(const asset &supply, const extended_asset &amount1_in, const extended_asset &amount1_before);
 
     std::tuple<asset, extended_asset, extended_asset, extended_asset>
-    count_deposit_amounts(const asset &lq_supply, const pool &current_pool, const extended_asset &token1, const extended_asset &token2);
+    count_deposit_amounts(const asset &lq_supply, const extended_asset &reserve1, const extended_asset &reserve2, const extended_asset &token1, const extended_asset &token2);
 
     std::tuple<asset, extended_asset, extended_asset, extended_asset>
     count_add_lq_amounts(const uint64_t &pool_id, const extended_asset &token1, const extended_asset &token2);
@@ -105,6 +213,12 @@ private:
     std::tuple<extended_asset, extended_asset>
     count_earnings_amounts(const asset &lqtokens);
 
+    extended_asset count_partial_fill(const std::vector<uint64_t> &pool_ids, const extended_asset &income, const uint64_t &min_amount);
+    extended_asset count_swap_in_amount(const uint64_t &pool_id, const extended_asset &amount_out);
+    extended_asset count_zap_swap_amount(const uint64_t &pool_id, const extended_asset &income);
+
+    double count_batch_price(const int64_t &reserve1, const int64_t &reserve2, const int64_t &amount1_in, const int64_t &amount2_in);
+
     extended_asset count_platform_fee(const asset &platform_fee, const extended_asset &income);
 
     std::tuple<extended_asset, extended_asset>
@@ -112,15 +226,22 @@ private:
 
     std::tuple<extended_asset, extended_asset, extended_asset, extended_asset, name, double>
     count_swap_amounts(const uint64_t &pool_id, const extended_asset &income);
+    std::tuple<extended_asset, extended_asset, extended_asset, extended_asset, name, double>
+    count_swap_amounts(const pool_quote &quote, const extended_asset &income);
+    pool_quote get_pool_quote(const uint64_t &pool_id);
 
     uint64_t get_new_pool_id(const uint64_t &available_id);
+    uint64_t get_next_route_id(const routes &_routes);
+    uint64_t get_next_intent_id(const intents &_intents, const uint64_t &pool_id);
     asset get_lq_supply(const symbol_code &token);
     std::tuple<extended_asset, extended_asset> get_pool_tokens(const symbol_code &pool_code);
+    std::tuple<extended_asset, extended_asset> get_pool_reserves(const uint64_t &pool_id);
     transaction get_income_trx();
     uint64_t get_pool_id(const symbol_code &code);
     time_point_sec get_inheritance_exp_date(const uint32_t &inactive_period);
 
     bool is_account_exist(const name &owner, const extended_symbol &token);
+    bool is_vault_exist(const name &owner, const extended_symbol &token);
     bool is_valid_deposits(const std::vector<deposit> &deposits);
     bool is_initial_add_lq(const asset &supply, const extended_asset &token1, const extended_asset &token2);
 
@@ -137,15 +258,35 @@ private:
 
     bool is_swap_memo(const std::string &memo);
     bool is_deposit_memo(const std::string &memo);
+    bool is_vault_memo(const std::string &memo);
+    bool is_compact_memo(const std::string &memo);
+    bool is_zap_memo(const std::string &memo);
+
+    bool is_digit(const std::string_view &str);
+    bool is_digit(const scratch_vector<std::string_view> &str);
+
+    std::tuple<bool, std::vector<uint64_t>, uint64_t, bool>
+    is_valid_swap_memo(const memo_params &params);
 
-    bool is_digit(const std::string &str);
-    bool is_digit(const std::vector<std::string> &str);
+    std::tuple<bool, compact_swap>
+    is_valid_compact_memo(const std::string &memo);
+
+    std::tuple<bool, uint64_t, uint64_t>
+    is_valid_route_memo(const memo_params &params);
 
     std::tuple<bool, std::vector<uint64_t>, uint64_t>
-    is_valid_swap_memo(const std::map<std::string, std::string> &params);
+    is_valid_swap_out_memo(const memo_params &params);
 
     std::tuple<bool, uint64_t>
-    is_valid_deposit_memo(const std::map<std::string, std::string> &params);
+    is_valid_deposit_memo(const memo_params &params);
+
+    std::tuple<bool, uint64_t, uint64_t>
+    is_valid_zap_memo(const memo_params &params);
+
+    std::tuple<bool, name>
+    is_valid_vault_memo(const memo_params &params);
+
+    bool is_notification_enabled(const name &owner, bool notify_policy::*kind);
 
     bool is_valid_inactive_period(const uint32_t &inactive_period);
     bool is_not_self_in_inheritors(const name &owner, const std::vector<inheritor_record> &inheritors);
@@ -158,7 +299,10 @@ private:
     void send_issue(const name &to, const asset &quantity, const std::string &memo);
     void send_retire(const name &from, const asset &quantity, const std::string &memo);
     void send_transfer(const name &contract, const name &to, const asset &quantity, const std::string &memo);
+    void send_clean_report(const name &keeper, const name &next_cursor, const symbol_code &next_row_cursor,
+                           const uint32_t &rows_erased, const uint64_t &bytes_freed);
     void send_swap_details(const uint64_t &pool_id, const name &owner, const extended_asset &token_in, const extended_asset &token_out, const extended_asset &pool_fee, const extended_asset &platform_fee, const double &price);
+    void send_batch_details(const uint64_t &pool_id, const double &price, const batch_side &side1, const batch_side &side2, const std::vector<batch_fill> &fills);
     void send_add_lq_details(const uint64_t &pool_id, const name &owner, const asset &lqtoken, const extended_asset &token1, const extended_asset &token2);
     void send_rmv_lq_details(const uint64_t &pool_id, const name &owner, const asset &lqtoken, const extended_asset &token1, const extended_asset &token2);
     void send_notify(const std::string &action_type, const name &to, const name &from, const asset &quantity, const std::string &memo);
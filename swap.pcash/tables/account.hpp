@@ -1,6 +1,7 @@
 #pragma once
 #include <eosio/asset.hpp>
 #include <eosio/eosio.hpp>
+#include "instrument.hpp"
 
 using namespace eosio;
 
@@ -13,4 +14,4 @@ struct [[eosio::contract("swap.pcash"), eosio::table]] account
         return balance.symbol.code().raw();
     }
 };
-using accounts = multi_index<name("accounts"), account>;
\ No newline at end of file
+using accounts = instrumented_table<name("accounts"), multi_index<name("accounts"), account>>;
\ No newline at end of file
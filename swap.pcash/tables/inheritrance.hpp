@@ -3,6 +3,7 @@
 #include <eosio/asset.hpp>
 #include <eosio/system.hpp>
 #include <eosio/time.hpp>
+#include "instrument.hpp"
 
 using namespace eosio;
 
@@ -31,4 +32,4 @@ struct [[eosio::contract("swap.pcash"), eosio::table]] member
     }
 };
 using by_date = indexed_by<name("bydate"), const_mem_fun<member, uint64_t, &member::date_key>>;
-using inheritance = multi_index<name("inheritance"), member, by_date>;
+using inheritance = instrumented_table<name("inheritance"), multi_index<name("inheritance"), member, by_date>>;
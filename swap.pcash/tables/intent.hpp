@@ -0,0 +1,31 @@
+#pragma once
+#include <eosio/eosio.hpp>
+#include <eosio/asset.hpp>
+#include <eosio/time.hpp>
+#include <eosio/singleton.hpp>
+#include "instrument.hpp"
+
+using namespace eosio;
+
+struct [[eosio::contract("swap.pcash"), eosio::table]] intent
+{
+    uint64_t id;
+    name owner;
+    extended_asset token_in;
+    uint64_t min_amount;
+    time_point_sec create_time;
+
+    uint64_t primary_key() const
+    {
+        return id;
+    }
+};
+using intents = instrumented_table<name("intents"), multi_index<name("intents"), intent>>;
+
+//Next intent id of a pool, scope is pool id. It only grows and outlives the pool, so an id settled or cancelled
+//once is never given to a later intent, not even in a new pool that reuses the pool id
+struct [[eosio::contract("swap.pcash"), eosio::table]] intent_counter
+{
+    uint64_t next_id = 0;
+};
+using intent_counters = singleton<name("intentseq"), intent_counter>;
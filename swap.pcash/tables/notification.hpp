@@ -0,0 +1,20 @@
+#pragma once
+#include <eosio/eosio.hpp>
+#include "instrument.hpp"
+
+using namespace eosio;
+
+//Row of an account turns its notifications on or off, row of the contract itself forces them on for everyone
+struct [[eosio::contract("swap.pcash"), eosio::table]] notify_policy
+{
+    name owner;
+    bool swap_details;
+    bool lq_details;
+    bool notify;
+
+    uint64_t primary_key() const
+    {
+        return owner.value;
+    }
+};
+using notify_policies = instrumented_table<name("ntfpolicy"), multi_index<name("ntfpolicy"), notify_policy>>;
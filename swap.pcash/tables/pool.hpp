@@ -1,6 +1,8 @@
 #pragma once
 #include <eosio/eosio.hpp>
 #include <eosio/asset.hpp>
+#include <eosio/binary_extension.hpp>
+#include "instrument.hpp"
 #include "resources.hpp"
 using namespace eosio;
 
@@ -15,6 +17,8 @@ struct [[eosio::contract("swap.pcash"), eosio::table]] pool
     time_point_sec last_update_time;
     extended_asset token1;
     extended_asset token2;
+    binary_extension<uint8_t> curve;
+    binary_extension<uint64_t> amp;
 
     uint64_t primary_key() const {
         return id;
@@ -30,4 +34,4 @@ struct [[eosio::contract("swap.pcash"), eosio::table]] pool
 };
 using by_code = indexed_by<name("bycode"), const_mem_fun<pool, uint64_t, &pool::code_key>>;
 using by_pair_key = indexed_by<name("bypair"), const_mem_fun<pool, checksum256, &pool::pair_key>>;
-using pools = multi_index<name("pools"), pool, by_code, by_pair_key>;
\ No newline at end of file
+using pools = instrumented_table<name("pools"), multi_index<name("pools"), pool, by_code, by_pair_key>>;
\ No newline at end of file
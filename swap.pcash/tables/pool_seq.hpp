@@ -0,0 +1,25 @@
+#pragma once
+#include <eosio/eosio.hpp>
+#include "instrument.hpp"
+
+using namespace eosio;
+
+//Block timestamp in microseconds of a pool's last change, shared by every pool changed in that block. Mirrors read
+//the byseq index from the last value they have seen, removed pools stay as tombstones so mirrors learn about them too
+struct [[eosio::contract("swap.pcash"), eosio::table]] pool_seq
+{
+    uint64_t pool_id;
+    uint64_t seq;
+    bool removed;
+
+    uint64_t primary_key() const
+    {
+        return pool_id;
+    }
+    uint64_t seq_key() const
+    {
+        return seq;
+    }
+};
+using by_seq = indexed_by<name("byseq"), const_mem_fun<pool_seq, uint64_t, &pool_seq::seq_key>>;
+using pool_seqs = instrumented_table<name("poolseq"), multi_index<name("poolseq"), pool_seq, by_seq>>;
@@ -0,0 +1,52 @@
+#pragma once
+#include <eosio/eosio.hpp>
+#include <eosio/asset.hpp>
+#include <eosio/time.hpp>
+#include "instrument.hpp"
+
+using namespace eosio;
+
+struct volume_bucket
+{
+    uint32_t hour = 0;
+    int64_t volume1 = 0;
+    int64_t volume2 = 0;
+    int64_t fee1 = 0;
+    int64_t fee2 = 0;
+
+    EOSLIB_SERIALIZE(volume_bucket, (hour)(volume1)(volume2)(fee1)(fee2))
+};
+
+//Hot state of a pool kept in the pool id scope, so swaps on different pools write disjoint rows.
+//Price accumulators are 32.32 fixed point and wrap on overflow, consumers use the difference of two readings.
+//Only the current hour's bucket is kept here, past hours move to poolvolume when the hour rolls over.
+//Pools created before this table existed get their row on the first update and read reserves from the pools table until then.
+struct [[eosio::contract("swap.pcash"), eosio::table]] pool_state
+{
+    uint64_t pool_id;
+    uint128_t price1_cumulative;
+    uint128_t price2_cumulative;
+    time_point_sec last_update_time;
+    volume_bucket volume;
+    extended_asset token1;
+    extended_asset token2;
+
+    uint64_t primary_key() const
+    {
+        return pool_id;
+    }
+};
+using pool_states = instrumented_table<name("poolstate"), multi_index<name("poolstate"), pool_state>>;
+
+//Ring of past hourly buckets in the pool id scope, indexed by hour modulo its size and written once per hour at most
+struct [[eosio::contract("swap.pcash"), eosio::table]] pool_volume
+{
+    uint64_t pool_id;
+    std::vector<volume_bucket> volumes;
+
+    uint64_t primary_key() const
+    {
+        return pool_id;
+    }
+};
+using pool_volumes = instrumented_table<name("poolvolume"), multi_index<name("poolvolume"), pool_volume>>;
@@ -0,0 +1,53 @@
+#pragma once
+#include <eosio/eosio.hpp>
+#include <eosio/asset.hpp>
+#include <eosio/singleton.hpp>
+#include "instrument.hpp"
+
+using namespace eosio;
+
+struct [[eosio::contract("swap.pcash"), eosio::table]] route
+{
+    uint64_t id;
+    name owner;
+    std::vector<uint64_t> pool_ids;
+    std::vector<extended_symbol> tokens;
+
+    uint64_t primary_key() const
+    {
+        return id;
+    }
+};
+using routes = instrumented_table<name("routes"), multi_index<name("routes"), route>>;
+
+//Scope is pool id, so removepool finds the routes going through the pool
+struct [[eosio::contract("swap.pcash"), eosio::table]] route_ref
+{
+    uint64_t route_id;
+
+    uint64_t primary_key() const
+    {
+        return route_id;
+    }
+};
+using route_refs = instrumented_table<name("routerefs"), multi_index<name("routerefs"), route_ref>>;
+
+//Routes of one owner through a pool, scope is owner, so the cap of one account is never used up by another
+struct [[eosio::contract("swap.pcash"), eosio::table]] route_count
+{
+    uint64_t pool_id;
+    uint32_t count;
+
+    uint64_t primary_key() const
+    {
+        return pool_id;
+    }
+};
+using route_counts = instrumented_table<name("routecounts"), multi_index<name("routecounts"), route_count>>;
+
+//Next route id, it only grows, so a memo naming a removed route can never run a route registered later
+struct [[eosio::contract("swap.pcash"), eosio::table]] route_counter
+{
+    uint64_t next_id = 0;
+};
+using route_counters = singleton<name("routeseq"), route_counter>;
@@ -1,6 +1,7 @@
 #pragma once
 #include <eosio/asset.hpp>
 #include <eosio/eosio.hpp>
+#include "instrument.hpp"
 
 using namespace eosio;
 
@@ -16,4 +17,4 @@ struct [[eosio::contract("swap.pcash"), eosio::table]] currency_stats
 	}
 };
 
-using stats = multi_index<name("stat"), currency_stats>;
+using stats = instrumented_table<name("stat"), multi_index<name("stat"), currency_stats>>;
@@ -0,0 +1,27 @@
+#pragma once
+#include <eosio/eosio.hpp>
+#include <eosio/asset.hpp>
+#include <eosio/binary_extension.hpp>
+#include "instrument.hpp"
+#include "resources.hpp"
+
+using namespace eosio;
+
+struct [[eosio::contract("swap.pcash"), eosio::table]] vault_balance
+{
+    uint64_t id;
+    extended_asset balance;
+    //Queued intents that pay into or refund to this row, vaultclose keeps the row while any is left
+    binary_extension<uint32_t> pending_intents;
+
+    uint64_t primary_key() const
+    {
+        return id;
+    }
+    uint128_t token_key() const
+    {
+        return to_token_key(balance.get_extended_symbol());
+    }
+};
+using by_token = indexed_by<name("bytoken"), const_mem_fun<vault_balance, uint128_t, &vault_balance::token_key>>;
+using vaults = instrumented_table<name("vaults"), multi_index<name("vaults"), vault_balance, by_token>>;